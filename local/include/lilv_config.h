@@ -21,6 +21,7 @@
 # define LILV_PATH_SEP ":"
 # define LILV_DIR_SEP "/"
 # define HAVE_FLOCK 1
+# define LILV_PARALLEL_LOAD 1
 #endif
 
 #if defined(__APPLE__)
@@ -146,6 +146,7 @@ struct LilvInstancePimpl {
 typedef struct {
 	bool dyn_manifest;
 	bool filter_language;
+	bool parallel_load;
 } LilvOptions;
 
 struct LilvWorldImpl {
@@ -23,6 +23,10 @@
 
 #include "lilv_internal.h"
 
+#ifdef LILV_PARALLEL_LOAD
+#    include <pthread.h>
+#endif
+
 static int
 lilv_world_drop_graph(LilvWorld* world, const SordNode* graph);
 
@@ -100,6 +104,7 @@ lilv_world_new(void)
 	world->n_read_files        = 0;
 	world->opt.filter_language = true;
 	world->opt.dyn_manifest    = true;
+	world->opt.parallel_load   = false;
 
 	return world;
 
@@ -179,6 +184,11 @@ lilv_world_set_option(LilvWorld*      world,
 			world->opt.filter_language = lilv_node_as_bool(value);
 			return;
 		}
+	} else if (!strcmp(option, LILV_OPTION_PARALLEL_LOAD)) {
+		if (lilv_node_is_bool(value)) {
+			world->opt.parallel_load = lilv_node_as_bool(value);
+			return;
+		}
 	}
 	LILV_WARNF("Unrecognized or invalid option `%s'\n", option);
 }
@@ -672,25 +682,15 @@ get_version(LilvWorld* world, SordModel* model, const LilvNode* subject)
 	return version;
 }
 
-LILV_API void
-lilv_world_load_bundle(LilvWorld* world, const LilvNode* bundle_uri)
+/** Add plugins and specifications of a bundle whose manifest is loaded.
+ * Takes ownership of `manifest`.
+ */
+static void
+lilv_world_add_bundle(LilvWorld*      world,
+                      const LilvNode* bundle_uri,
+                      LilvNode*       manifest)
 {
-	if (!lilv_node_is_uri(bundle_uri)) {
-		LILV_ERRORF("Bundle URI `%s' is not a URI\n",
-		            sord_node_get_string(bundle_uri->node));
-		return;
-	}
-
 	SordNode* bundle_node = bundle_uri->node;
-	LilvNode* manifest    = lilv_world_get_manifest_uri(world, bundle_uri);
-
-	// Read manifest into model with graph = bundle_node
-	SerdStatus st = lilv_world_load_graph(world, bundle_node, manifest);
-	if (st > SERD_FAILURE) {
-		LILV_ERRORF("Error reading %s\n", lilv_node_as_string(manifest));
-		lilv_node_free(manifest);
-		return;
-	}
 
 	// ?plugin a lv2:Plugin
 	SordIter* plug_results = sord_search(world->model,
@@ -806,6 +806,29 @@ lilv_world_load_bundle(LilvWorld* world, const LilvNode* bundle_uri)
 	lilv_node_free(manifest);
 }
 
+LILV_API void
+lilv_world_load_bundle(LilvWorld* world, const LilvNode* bundle_uri)
+{
+	if (!lilv_node_is_uri(bundle_uri)) {
+		LILV_ERRORF("Bundle URI `%s' is not a URI\n",
+		            sord_node_get_string(bundle_uri->node));
+		return;
+	}
+
+	SordNode* bundle_node = bundle_uri->node;
+	LilvNode* manifest    = lilv_world_get_manifest_uri(world, bundle_uri);
+
+	// Read manifest into model with graph = bundle_node
+	SerdStatus st = lilv_world_load_graph(world, bundle_node, manifest);
+	if (st > SERD_FAILURE) {
+		LILV_ERRORF("Error reading %s\n", lilv_node_as_string(manifest));
+		lilv_node_free(manifest);
+		return;
+	}
+
+	lilv_world_add_bundle(world, bundle_uri, manifest);
+}
+
 static int
 lilv_world_drop_graph(LilvWorld* world, const SordNode* graph)
 {
@@ -903,17 +926,6 @@ load_dir_entry(const char* dir, const char* name, void* data)
 	free(path);
 }
 
-/** Load all bundles in the directory at `dir_path`. */
-static void
-lilv_world_load_directory(LilvWorld* world, const char* dir_path)
-{
-	char* path = lilv_expand(dir_path);
-	if (path) {
-		lilv_dir_for_each(path, world, load_dir_entry);
-		free(path);
-	}
-}
-
 static const char*
 first_path_sep(const char* path)
 {
@@ -925,6 +937,306 @@ first_path_sep(const char* path)
 	return NULL;
 }
 
+/** Call `f` for every entry of all directories in `lv2_path`.
+ * @param lv2_path A colon-delimited list of directories.
+ */
+static void
+lilv_for_each_bundle_dir(const char* lv2_path,
+                         void*       data,
+                         void (*f)(const char* dir, const char* name, void* data))
+{
+	while (lv2_path[0] != '\0') {
+		const char* const sep     = first_path_sep(lv2_path);
+		const size_t      dir_len = sep ? (size_t)(sep - lv2_path) : strlen(lv2_path);
+		char* const       dir     = (char*)malloc(dir_len + 1);
+		memcpy(dir, lv2_path, dir_len);
+		dir[dir_len] = '\0';
+
+		char* path = lilv_expand(dir);
+		if (path) {
+			lilv_dir_for_each(path, data, f);
+			free(path);
+		}
+		free(dir);
+		lv2_path += sep ? dir_len + 1 : dir_len;
+	}
+}
+
+#ifdef LILV_PARALLEL_LOAD
+
+/* Parallel discovery: manifests are read by several threads, each into a
+   private buffer of serd events (the sord world is not thread-safe).  The
+   buffers are then replayed into the world model in bundle order, so the
+   result is the same as loading serially (apart from blank node labels).
+*/
+
+#define LILV_MAX_LOAD_THREADS 8
+
+typedef struct {
+	char*      path;          ///< Bundle directory
+	LilvNode*  bundle_uri;
+	LilvNode*  manifest;
+	char*      blank_prefix;  ///< NULL if the manifest was loaded before
+	uint8_t*   events;        ///< Recorded serd events
+	size_t     n_events;      ///< Size of events in bytes
+	size_t     events_size;   ///< Allocated size of events
+	SerdStatus st;
+} LilvPendingBundle;
+
+typedef struct {
+	LilvPendingBundle* bundles;
+	unsigned           n_bundles;
+	unsigned           next;      ///< Next bundle to read (atomic)
+} LilvLoadQueue;
+
+enum { EV_BASE = 'B', EV_PREFIX = 'P', EV_STATEMENT = 'S' };
+
+static void
+pending_append(LilvPendingBundle* b, const void* data, size_t len)
+{
+	if (b->n_events + len > b->events_size) {
+		size_t size = b->events_size ? b->events_size * 2 : 4096;
+		while (size < b->n_events + len) {
+			size *= 2;
+		}
+		b->events      = (uint8_t*)realloc(b->events, size);
+		b->events_size = size;
+	}
+	memcpy(b->events + b->n_events, data, len);
+	b->n_events += len;
+}
+
+static void
+pending_append_node(LilvPendingBundle* b, const SerdNode* node)
+{
+	SerdNode n = node ? *node : SERD_NODE_NULL;
+	if (!n.buf) {
+		n.type    = SERD_NOTHING;
+		n.n_bytes = 0;
+	}
+	pending_append(b, &n, sizeof(SerdNode));
+	if (n.type != SERD_NOTHING) {
+		pending_append(b, n.buf, n.n_bytes + 1);
+	}
+}
+
+static const uint8_t*
+pending_read_node(const uint8_t* p, SerdNode* node)
+{
+	memcpy(node, p, sizeof(SerdNode));
+	p += sizeof(SerdNode);
+	if (node->type == SERD_NOTHING) {
+		*node = SERD_NODE_NULL;
+		return p;
+	}
+	node->buf = p;
+	return p + node->n_bytes + 1;
+}
+
+static SerdStatus
+pending_base(void* handle, const SerdNode* uri)
+{
+	LilvPendingBundle* b = (LilvPendingBundle*)handle;
+	const uint8_t      e = EV_BASE;
+	pending_append(b, &e, 1);
+	pending_append_node(b, uri);
+	return SERD_SUCCESS;
+}
+
+static SerdStatus
+pending_prefix(void* handle, const SerdNode* name, const SerdNode* uri)
+{
+	LilvPendingBundle* b = (LilvPendingBundle*)handle;
+	const uint8_t      e = EV_PREFIX;
+	pending_append(b, &e, 1);
+	pending_append_node(b, name);
+	pending_append_node(b, uri);
+	return SERD_SUCCESS;
+}
+
+static SerdStatus
+pending_statement(void*              handle,
+                  SerdStatementFlags flags,
+                  const SerdNode*    graph,
+                  const SerdNode*    subject,
+                  const SerdNode*    predicate,
+                  const SerdNode*    object,
+                  const SerdNode*    object_datatype,
+                  const SerdNode*    object_lang)
+{
+	LilvPendingBundle* b = (LilvPendingBundle*)handle;
+	const uint8_t      e = EV_STATEMENT;
+	pending_append(b, &e, 1);
+	pending_append(b, &flags, sizeof(flags));
+	pending_append_node(b, graph);
+	pending_append_node(b, subject);
+	pending_append_node(b, predicate);
+	pending_append_node(b, object);
+	pending_append_node(b, object_datatype);
+	pending_append_node(b, object_lang);
+	return SERD_SUCCESS;
+}
+
+static void*
+lilv_load_thread(void* data)
+{
+	LilvLoadQueue* q = (LilvLoadQueue*)data;
+	unsigned       i;
+	while ((i = __sync_fetch_and_add(&q->next, 1)) < q->n_bundles) {
+		LilvPendingBundle* b = &q->bundles[i];
+		if (!b->blank_prefix) {
+			continue;
+		}
+		SerdReader* reader = serd_reader_new(
+			SERD_TURTLE, b, NULL,
+			pending_base, pending_prefix, pending_statement, NULL);
+		serd_reader_add_blank_prefix(reader, (const uint8_t*)b->blank_prefix);
+		b->st = serd_reader_read_file(
+			reader, sord_node_get_string(b->manifest->node));
+		serd_reader_free(reader);
+	}
+	return NULL;
+}
+
+/** Insert the recorded events of `b` into the world model, in the same way
+    lilv_world_load_graph() would. */
+static SerdStatus
+lilv_world_replay_bundle(LilvWorld* world, LilvPendingBundle* b)
+{
+	SerdEnv* env = serd_env_new(sord_node_to_serd_node(b->manifest->node));
+	SordInserter*   inserter = sord_inserter_new(world->model, env);
+	const SerdNode* graph    = sord_node_to_serd_node(b->bundle_uri->node);
+
+	const uint8_t* p   = b->events;
+	const uint8_t* end = b->events + b->n_events;
+	while (p < end) {
+		const uint8_t e = *p++;
+		SerdNode      n[6];
+		if (e == EV_BASE) {
+			p = pending_read_node(p, &n[0]);
+			sord_inserter_set_base_uri(inserter, &n[0]);
+		} else if (e == EV_PREFIX) {
+			p = pending_read_node(p, &n[0]);
+			p = pending_read_node(p, &n[1]);
+			sord_inserter_set_prefix(inserter, &n[0], &n[1]);
+		} else {
+			SerdStatementFlags flags;
+			memcpy(&flags, p, sizeof(flags));
+			p += sizeof(flags);
+			for (int k = 0; k < 6; ++k) {
+				p = pending_read_node(p, &n[k]);
+			}
+			sord_inserter_write_statement(
+				inserter, flags, n[0].buf ? &n[0] : graph,
+				&n[1], &n[2], &n[3],
+				n[4].buf ? &n[4] : NULL,
+				n[5].buf ? &n[5] : NULL);
+		}
+	}
+
+	sord_inserter_free(inserter);
+	serd_env_free(env);
+
+	if (b->st) {
+		LILV_ERRORF("Error loading file `%s'\n", lilv_node_as_string(b->manifest));
+		return b->st;
+	}
+	zix_tree_insert((ZixTree*)world->loaded_files,
+	                lilv_node_duplicate(b->manifest),
+	                NULL);
+	return SERD_SUCCESS;
+}
+
+static void
+pending_dir_entry(const char* dir, const char* name, void* data)
+{
+	LilvLoadQueue* q = (LilvLoadQueue*)data;
+	if (!strcmp(name, ".") || !strcmp(name, "..")) {
+		return;
+	}
+	q->bundles = (LilvPendingBundle*)realloc(
+		q->bundles, (q->n_bundles + 1) * sizeof(LilvPendingBundle));
+	LilvPendingBundle* b = &q->bundles[q->n_bundles++];
+	memset(b, 0, sizeof(LilvPendingBundle));
+	b->path = lilv_strjoin(dir, "/", name, "/", NULL);
+}
+
+static unsigned
+lilv_load_thread_count(unsigned n_bundles)
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n > LILV_MAX_LOAD_THREADS) {
+		n = LILV_MAX_LOAD_THREADS;
+	}
+	if (n > (long)n_bundles) {
+		n = n_bundles;
+	}
+	return n > 1 ? (unsigned)n : 1;
+}
+
+static void
+lilv_world_load_path_parallel(LilvWorld* world, const char* lv2_path)
+{
+	LilvLoadQueue q = { NULL, 0, 0 };
+
+	// Discover bundles (list all directories, in the order lilv would)
+	lilv_for_each_bundle_dir(lv2_path, &q, pending_dir_entry);
+
+	// Assign blank node prefixes in order, skip already loaded manifests
+	for (unsigned i = 0; i < q.n_bundles; ++i) {
+		LilvPendingBundle* b = &q.bundles[i];
+		SerdNode suri = serd_node_new_file_uri(
+			(const uint8_t*)b->path, 0, 0, true);
+		b->bundle_uri = lilv_new_uri(world, (const char*)suri.buf);
+		b->manifest   = lilv_world_get_manifest_uri(world, b->bundle_uri);
+		serd_node_free(&suri);
+
+		ZixTreeIter* iter;
+		if (zix_tree_find((ZixTree*)world->loaded_files, b->manifest, &iter)) {
+			b->blank_prefix = lilv_strdup(
+				(const char*)lilv_world_blank_node_prefix(world));
+		} else {
+			b->st = SERD_FAILURE;
+		}
+	}
+
+	// Read and parse manifests
+	const unsigned n_threads = lilv_load_thread_count(q.n_bundles);
+	pthread_t      threads[LILV_MAX_LOAD_THREADS];
+	unsigned       n_started = 0;
+	for (unsigned t = 1; t < n_threads; ++t) {
+		if (!pthread_create(&threads[n_started], NULL, lilv_load_thread, &q)) {
+			++n_started;
+		}
+	}
+	lilv_load_thread(&q);
+	for (unsigned t = 0; t < n_started; ++t) {
+		pthread_join(threads[t], NULL);
+	}
+
+	// Merge into the world and add plugins, in bundle order
+	for (unsigned i = 0; i < q.n_bundles; ++i) {
+		LilvPendingBundle* b = &q.bundles[i];
+		SerdStatus         st = b->st;
+		if (b->blank_prefix) {
+			st = lilv_world_replay_bundle(world, b);
+		}
+		if (st > SERD_FAILURE) {
+			LILV_ERRORF("Error reading %s\n", lilv_node_as_string(b->manifest));
+			lilv_node_free(b->manifest);
+		} else {
+			lilv_world_add_bundle(world, b->bundle_uri, b->manifest);
+		}
+		lilv_node_free(b->bundle_uri);
+		free(b->blank_prefix);
+		free(b->events);
+		free(b->path);
+	}
+	free(q.bundles);
+}
+
+#endif  // LILV_PARALLEL_LOAD
+
 /** Load all bundles found in `lv2_path`.
  * @param lv2_path A colon-delimited list of directories.  These directories
  * should contain LV2 bundle directories (ie the search path is a list of
@@ -934,21 +1246,13 @@ static void
 lilv_world_load_path(LilvWorld*  world,
                      const char* lv2_path)
 {
-	while (lv2_path[0] != '\0') {
-		const char* const sep = first_path_sep(lv2_path);
-		if (sep) {
-			const size_t dir_len = sep - lv2_path;
-			char* const  dir     = (char*)malloc(dir_len + 1);
-			memcpy(dir, lv2_path, dir_len);
-			dir[dir_len] = '\0';
-			lilv_world_load_directory(world, dir);
-			free(dir);
-			lv2_path += dir_len + 1;
-		} else {
-			lilv_world_load_directory(world, lv2_path);
-			lv2_path = "\0";
-		}
+#ifdef LILV_PARALLEL_LOAD
+	if (world->opt.parallel_load) {
+		lilv_world_load_path_parallel(world, lv2_path);
+		return;
 	}
+#endif
+	lilv_for_each_bundle_dir(lv2_path, world, load_dir_entry);
 }
 
 void
@@ -0,0 +1,121 @@
+/*
+ *  Copyright (C) 2016 Robin Gareus <robin@gareus.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+# include <windows.h>
+# include <fcntl.h>
+# include <io.h>
+#else
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
+#include "atomicfile.h"
+
+FILE* atomic_write_open (const char* file, char** tmp)
+{
+	size_t len = strlen (file) + 8;
+	*tmp = (char*) malloc (len);
+	if (!*tmp) {
+		return NULL;
+	}
+	snprintf (*tmp, len, "%s.XXXXXX", file);
+#ifdef _WIN32
+	int fd = -1;
+	if (_mktemp_s (*tmp, len) == 0) {
+		fd = _open (*tmp, _O_CREAT | _O_EXCL | _O_WRONLY | _O_BINARY, _S_IREAD | _S_IWRITE);
+	}
+	FILE* f = fd >= 0 ? _fdopen (fd, "wb") : NULL;
+	if (fd >= 0 && !f) {
+		_close (fd);
+	}
+#else
+	int fd = mkstemp (*tmp);
+	FILE* f = fd >= 0 ? fdopen (fd, "wb") : NULL;
+	if (fd >= 0 && !f) {
+		close (fd);
+	}
+#endif
+	if (!f) {
+		if (fd >= 0) {
+			remove (*tmp);
+		}
+		free (*tmp);
+		*tmp = NULL;
+	}
+	return f;
+}
+
+#ifdef _WIN32
+/* file names are UTF-8 */
+static wchar_t* to_wide (const char* s)
+{
+	int len = MultiByteToWideChar (CP_UTF8, 0, s, -1, NULL, 0);
+	if (len <= 0) {
+		return NULL;
+	}
+	wchar_t* w = (wchar_t*) malloc (len * sizeof (wchar_t));
+	if (w && MultiByteToWideChar (CP_UTF8, 0, s, -1, w, len) != len) {
+		free (w);
+		return NULL;
+	}
+	return w;
+}
+
+/* rename () fails if the target exists, replace it in one step */
+static bool replace_file (const char* tmp, const char* file)
+{
+	wchar_t* wtmp  = to_wide (tmp);
+	wchar_t* wfile = to_wide (file);
+	bool ok = wtmp && wfile
+		&& MoveFileExW (wtmp, wfile, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+	free (wtmp);
+	free (wfile);
+	return ok;
+}
+#else
+static bool replace_file (const char* tmp, const char* file)
+{
+	return rename (tmp, file) == 0;
+}
+#endif
+
+bool atomic_write_commit (FILE* f, char* tmp, const char* file)
+{
+	/* the data must be on disk before the rename makes it visible */
+	bool ok = fflush (f) == 0 && !ferror (f);
+#ifdef _WIN32
+	ok = ok && _commit (_fileno (f)) == 0;
+#else
+	ok = ok && fsync (fileno (f)) == 0;
+#endif
+	ok &= fclose (f) == 0;
+
+	if (!ok || !replace_file (tmp, file)) {
+		remove (tmp);
+		ok = false;
+	}
+	free (tmp);
+	return ok;
+}
@@ -0,0 +1,35 @@
+/*
+ *  Copyright (C) 2016 Robin Gareus <robin@gareus.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _atomicfile_h_
+#define _atomicfile_h_
+
+#include <stdio.h>
+
+/* replace a file atomically: write to a uniquely named file next to it,
+ * which is flushed to disk and then renamed over the target.
+ * Concurrent writers each use their own temporary file. */
+
+/* create the temporary file for `file`, `*tmp` receives its name */
+FILE* atomic_write_open (const char* file, char** tmp);
+
+/* close and sync `f`, move it into place, and free `tmp`.
+ * On failure the temporary file is removed and `file` is untouched. */
+bool atomic_write_commit (FILE* f, char* tmp, const char* file);
+
+#endif
@@ -0,0 +1,570 @@
+/*
+ *  Copyright (C) 2016 Robin Gareus <robin@gareus.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include <stdint.h>
+
+#if (defined __x86_64__ || defined __i386__) && defined __GNUC__
+# define X86_KERNELS 1
+# include <immintrin.h>
+# define TARGET_SSE2 __attribute__((target("sse2")))
+# define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#if defined __ARM_NEON || defined __ARM_NEON__
+# define NEON_KERNELS 1
+# include <arm_neon.h>
+#endif
+
+#include <vlc_common.h>
+#include <vlc_threads.h>
+
+#include "interleave.h"
+
+#define MAX_KERNEL_CHN 8
+
+typedef void (*DeinterleaveFn)(float* const*, const float*, uint32_t);
+typedef void (*InterleaveFn)(float*, float* const*, uint32_t);
+
+/* ****************************************************************************
+ * scalar fallback
+ */
+
+template<uint32_t N>
+static void deinterleave_n (float* const* dst, const float* src, uint32_t n_samples)
+{
+	float* d[N > 0 ? N : 1];
+	for (uint32_t c = 0; c < N; ++c) {
+		d[c] = dst[c];
+	}
+	for (uint32_t s = 0; s < n_samples; ++s) {
+		for (uint32_t c = 0; c < N; ++c) {
+			d[c][s] = *(src++);
+		}
+	}
+}
+
+template<uint32_t N>
+static void interleave_n (float* dst, float* const* src, uint32_t n_samples)
+{
+	const float* d[N > 0 ? N : 1];
+	for (uint32_t c = 0; c < N; ++c) {
+		d[c] = src[c];
+	}
+	for (uint32_t s = 0; s < n_samples; ++s) {
+		for (uint32_t c = 0; c < N; ++c) {
+			*(dst++) = d[c][s];
+		}
+	}
+}
+
+static void deinterleave_1 (float* const* dst, const float* src, uint32_t n_samples)
+{
+	if (dst[0] != src) {
+		memcpy (dst[0], src, n_samples * sizeof (float));
+	}
+}
+
+static void interleave_1 (float* dst, float* const* src, uint32_t n_samples)
+{
+	if (dst != src[0]) {
+		memcpy (dst, src[0], n_samples * sizeof (float));
+	}
+}
+
+/* ****************************************************************************
+ * x86 SSE2 / AVX2
+ */
+
+#ifdef X86_KERNELS
+
+TARGET_SSE2 static void deinterleave_2_sse2 (float* const* dst, const float* src, uint32_t n_samples)
+{
+	float* d0 = dst[0];
+	float* d1 = dst[1];
+	uint32_t s = 0;
+	for (; s + 4 <= n_samples; s += 4, src += 8) {
+		__m128 a = _mm_loadu_ps (src);
+		__m128 b = _mm_loadu_ps (src + 4);
+		_mm_storeu_ps (d0 + s, _mm_shuffle_ps (a, b, _MM_SHUFFLE (2, 0, 2, 0)));
+		_mm_storeu_ps (d1 + s, _mm_shuffle_ps (a, b, _MM_SHUFFLE (3, 1, 3, 1)));
+	}
+	for (; s < n_samples; ++s, src += 2) {
+		d0[s] = src[0];
+		d1[s] = src[1];
+	}
+}
+
+TARGET_SSE2 static void interleave_2_sse2 (float* dst, float* const* src, uint32_t n_samples)
+{
+	const float* s0 = src[0];
+	const float* s1 = src[1];
+	uint32_t s = 0;
+	for (; s + 4 <= n_samples; s += 4, dst += 8) {
+		__m128 l = _mm_loadu_ps (s0 + s);
+		__m128 r = _mm_loadu_ps (s1 + s);
+		_mm_storeu_ps (dst,     _mm_unpacklo_ps (l, r));
+		_mm_storeu_ps (dst + 4, _mm_unpackhi_ps (l, r));
+	}
+	for (; s < n_samples; ++s, dst += 2) {
+		dst[0] = s0[s];
+		dst[1] = s1[s];
+	}
+}
+
+TARGET_SSE2 static void deinterleave_4_sse2 (float* const* dst, const float* src, uint32_t n_samples)
+{
+	uint32_t s = 0;
+	for (; s + 4 <= n_samples; s += 4, src += 16) {
+		__m128 r0 = _mm_loadu_ps (src);
+		__m128 r1 = _mm_loadu_ps (src + 4);
+		__m128 r2 = _mm_loadu_ps (src + 8);
+		__m128 r3 = _mm_loadu_ps (src + 12);
+		_MM_TRANSPOSE4_PS (r0, r1, r2, r3);
+		_mm_storeu_ps (dst[0] + s, r0);
+		_mm_storeu_ps (dst[1] + s, r1);
+		_mm_storeu_ps (dst[2] + s, r2);
+		_mm_storeu_ps (dst[3] + s, r3);
+	}
+	for (; s < n_samples; ++s) {
+		for (uint32_t c = 0; c < 4; ++c) {
+			dst[c][s] = *(src++);
+		}
+	}
+}
+
+TARGET_SSE2 static void interleave_4_sse2 (float* dst, float* const* src, uint32_t n_samples)
+{
+	uint32_t s = 0;
+	for (; s + 4 <= n_samples; s += 4, dst += 16) {
+		__m128 r0 = _mm_loadu_ps (src[0] + s);
+		__m128 r1 = _mm_loadu_ps (src[1] + s);
+		__m128 r2 = _mm_loadu_ps (src[2] + s);
+		__m128 r3 = _mm_loadu_ps (src[3] + s);
+		_MM_TRANSPOSE4_PS (r0, r1, r2, r3);
+		_mm_storeu_ps (dst,      r0);
+		_mm_storeu_ps (dst + 4,  r1);
+		_mm_storeu_ps (dst + 8,  r2);
+		_mm_storeu_ps (dst + 12, r3);
+	}
+	for (; s < n_samples; ++s) {
+		for (uint32_t c = 0; c < 4; ++c) {
+			*(dst++) = src[c][s];
+		}
+	}
+}
+
+/* 5.1: transpose channels 0..3 and (overlapping) 2..5 of four frames */
+TARGET_SSE2 static void deinterleave_6_sse2 (float* const* dst, const float* src, uint32_t n_samples)
+{
+	uint32_t s = 0;
+	for (; s + 4 <= n_samples; s += 4, src += 24) {
+		__m128 a0 = _mm_loadu_ps (src);
+		__m128 a1 = _mm_loadu_ps (src + 6);
+		__m128 a2 = _mm_loadu_ps (src + 12);
+		__m128 a3 = _mm_loadu_ps (src + 18);
+		__m128 b0 = _mm_loadu_ps (src + 2);
+		__m128 b1 = _mm_loadu_ps (src + 8);
+		__m128 b2 = _mm_loadu_ps (src + 14);
+		__m128 b3 = _mm_loadu_ps (src + 20);
+		_MM_TRANSPOSE4_PS (a0, a1, a2, a3);
+		_MM_TRANSPOSE4_PS (b0, b1, b2, b3);
+		_mm_storeu_ps (dst[0] + s, a0);
+		_mm_storeu_ps (dst[1] + s, a1);
+		_mm_storeu_ps (dst[2] + s, a2);
+		_mm_storeu_ps (dst[3] + s, a3);
+		_mm_storeu_ps (dst[4] + s, b2);
+		_mm_storeu_ps (dst[5] + s, b3);
+	}
+	for (; s < n_samples; ++s) {
+		for (uint32_t c = 0; c < 6; ++c) {
+			dst[c][s] = *(src++);
+		}
+	}
+}
+
+TARGET_SSE2 static void interleave_6_sse2 (float* dst, float* const* src, uint32_t n_samples)
+{
+	uint32_t s = 0;
+	for (; s + 4 <= n_samples; s += 4, dst += 24) {
+		__m128 a0 = _mm_loadu_ps (src[0] + s);
+		__m128 a1 = _mm_loadu_ps (src[1] + s);
+		__m128 a2 = _mm_loadu_ps (src[2] + s);
+		__m128 a3 = _mm_loadu_ps (src[3] + s);
+		__m128 b0 = a2;
+		__m128 b1 = a3;
+		__m128 b2 = _mm_loadu_ps (src[4] + s);
+		__m128 b3 = _mm_loadu_ps (src[5] + s);
+		_MM_TRANSPOSE4_PS (a0, a1, a2, a3);
+		_MM_TRANSPOSE4_PS (b0, b1, b2, b3);
+		/* the second store of each frame re-writes channels 2, 3 with identical values */
+		_mm_storeu_ps (dst,      a0);
+		_mm_storeu_ps (dst + 2,  b0);
+		_mm_storeu_ps (dst + 6,  a1);
+		_mm_storeu_ps (dst + 8,  b1);
+		_mm_storeu_ps (dst + 12, a2);
+		_mm_storeu_ps (dst + 14, b2);
+		_mm_storeu_ps (dst + 18, a3);
+		_mm_storeu_ps (dst + 20, b3);
+	}
+	for (; s < n_samples; ++s) {
+		for (uint32_t c = 0; c < 6; ++c) {
+			*(dst++) = src[c][s];
+		}
+	}
+}
+
+/* 7.1: two 4x4 transposes per four frames */
+TARGET_SSE2 static void deinterleave_8_sse2 (float* const* dst, const float* src, uint32_t n_samples)
+{
+	uint32_t s = 0;
+	for (; s + 4 <= n_samples; s += 4, src += 32) {
+		__m128 a0 = _mm_loadu_ps (src);
+		__m128 a1 = _mm_loadu_ps (src + 8);
+		__m128 a2 = _mm_loadu_ps (src + 16);
+		__m128 a3 = _mm_loadu_ps (src + 24);
+		__m128 b0 = _mm_loadu_ps (src + 4);
+		__m128 b1 = _mm_loadu_ps (src + 12);
+		__m128 b2 = _mm_loadu_ps (src + 20);
+		__m128 b3 = _mm_loadu_ps (src + 28);
+		_MM_TRANSPOSE4_PS (a0, a1, a2, a3);
+		_MM_TRANSPOSE4_PS (b0, b1, b2, b3);
+		_mm_storeu_ps (dst[0] + s, a0);
+		_mm_storeu_ps (dst[1] + s, a1);
+		_mm_storeu_ps (dst[2] + s, a2);
+		_mm_storeu_ps (dst[3] + s, a3);
+		_mm_storeu_ps (dst[4] + s, b0);
+		_mm_storeu_ps (dst[5] + s, b1);
+		_mm_storeu_ps (dst[6] + s, b2);
+		_mm_storeu_ps (dst[7] + s, b3);
+	}
+	for (; s < n_samples; ++s) {
+		for (uint32_t c = 0; c < 8; ++c) {
+			dst[c][s] = *(src++);
+		}
+	}
+}
+
+TARGET_SSE2 static void interleave_8_sse2 (float* dst, float* const* src, uint32_t n_samples)
+{
+	uint32_t s = 0;
+	for (; s + 4 <= n_samples; s += 4, dst += 32) {
+		__m128 a0 = _mm_loadu_ps (src[0] + s);
+		__m128 a1 = _mm_loadu_ps (src[1] + s);
+		__m128 a2 = _mm_loadu_ps (src[2] + s);
+		__m128 a3 = _mm_loadu_ps (src[3] + s);
+		__m128 b0 = _mm_loadu_ps (src[4] + s);
+		__m128 b1 = _mm_loadu_ps (src[5] + s);
+		__m128 b2 = _mm_loadu_ps (src[6] + s);
+		__m128 b3 = _mm_loadu_ps (src[7] + s);
+		_MM_TRANSPOSE4_PS (a0, a1, a2, a3);
+		_MM_TRANSPOSE4_PS (b0, b1, b2, b3);
+		_mm_storeu_ps (dst,      a0);
+		_mm_storeu_ps (dst + 4,  b0);
+		_mm_storeu_ps (dst + 8,  a1);
+		_mm_storeu_ps (dst + 12, b1);
+		_mm_storeu_ps (dst + 16, a2);
+		_mm_storeu_ps (dst + 20, b2);
+		_mm_storeu_ps (dst + 24, a3);
+		_mm_storeu_ps (dst + 28, b3);
+	}
+	for (; s < n_samples; ++s) {
+		for (uint32_t c = 0; c < 8; ++c) {
+			*(dst++) = src[c][s];
+		}
+	}
+}
+
+TARGET_AVX2 static void deinterleave_2_avx2 (float* const* dst, const float* src, uint32_t n_samples)
+{
+	float* d0 = dst[0];
+	float* d1 = dst[1];
+	uint32_t s = 0;
+	for (; s + 8 <= n_samples; s += 8, src += 16) {
+		__m256 a = _mm256_loadu_ps (src);
+		__m256 b = _mm256_loadu_ps (src + 8);
+		/* per 128bit lane: L0 L1 L4 L5 | L2 L3 L6 L7 -> reorder 64bit pairs */
+		__m256 l = _mm256_shuffle_ps (a, b, _MM_SHUFFLE (2, 0, 2, 0));
+		__m256 r = _mm256_shuffle_ps (a, b, _MM_SHUFFLE (3, 1, 3, 1));
+		l = _mm256_castpd_ps (_mm256_permute4x64_pd (_mm256_castps_pd (l), _MM_SHUFFLE (3, 1, 2, 0)));
+		r = _mm256_castpd_ps (_mm256_permute4x64_pd (_mm256_castps_pd (r), _MM_SHUFFLE (3, 1, 2, 0)));
+		_mm256_storeu_ps (d0 + s, l);
+		_mm256_storeu_ps (d1 + s, r);
+	}
+	_mm256_zeroupper ();
+	for (; s < n_samples; ++s, src += 2) {
+		d0[s] = src[0];
+		d1[s] = src[1];
+	}
+}
+
+TARGET_AVX2 static void interleave_2_avx2 (float* dst, float* const* src, uint32_t n_samples)
+{
+	const float* s0 = src[0];
+	const float* s1 = src[1];
+	uint32_t s = 0;
+	for (; s + 8 <= n_samples; s += 8, dst += 16) {
+		__m256 l  = _mm256_loadu_ps (s0 + s);
+		__m256 r  = _mm256_loadu_ps (s1 + s);
+		__m256 lo = _mm256_unpacklo_ps (l, r);
+		__m256 hi = _mm256_unpackhi_ps (l, r);
+		_mm256_storeu_ps (dst,     _mm256_permute2f128_ps (lo, hi, 0x20));
+		_mm256_storeu_ps (dst + 8, _mm256_permute2f128_ps (lo, hi, 0x31));
+	}
+	_mm256_zeroupper ();
+	for (; s < n_samples; ++s, dst += 2) {
+		dst[0] = s0[s];
+		dst[1] = s1[s];
+	}
+}
+
+TARGET_AVX2 static inline void transpose_8x8 (__m256* r)
+{
+	__m256 t0 = _mm256_unpacklo_ps (r[0], r[1]);
+	__m256 t1 = _mm256_unpackhi_ps (r[0], r[1]);
+	__m256 t2 = _mm256_unpacklo_ps (r[2], r[3]);
+	__m256 t3 = _mm256_unpackhi_ps (r[2], r[3]);
+	__m256 t4 = _mm256_unpacklo_ps (r[4], r[5]);
+	__m256 t5 = _mm256_unpackhi_ps (r[4], r[5]);
+	__m256 t6 = _mm256_unpacklo_ps (r[6], r[7]);
+	__m256 t7 = _mm256_unpackhi_ps (r[6], r[7]);
+
+	__m256 u0 = _mm256_shuffle_ps (t0, t2, _MM_SHUFFLE (1, 0, 1, 0));
+	__m256 u1 = _mm256_shuffle_ps (t0, t2, _MM_SHUFFLE (3, 2, 3, 2));
+	__m256 u2 = _mm256_shuffle_ps (t1, t3, _MM_SHUFFLE (1, 0, 1, 0));
+	__m256 u3 = _mm256_shuffle_ps (t1, t3, _MM_SHUFFLE (3, 2, 3, 2));
+	__m256 u4 = _mm256_shuffle_ps (t4, t6, _MM_SHUFFLE (1, 0, 1, 0));
+	__m256 u5 = _mm256_shuffle_ps (t4, t6, _MM_SHUFFLE (3, 2, 3, 2));
+	__m256 u6 = _mm256_shuffle_ps (t5, t7, _MM_SHUFFLE (1, 0, 1, 0));
+	__m256 u7 = _mm256_shuffle_ps (t5, t7, _MM_SHUFFLE (3, 2, 3, 2));
+
+	r[0] = _mm256_permute2f128_ps (u0, u4, 0x20);
+	r[1] = _mm256_permute2f128_ps (u1, u5, 0x20);
+	r[2] = _mm256_permute2f128_ps (u2, u6, 0x20);
+	r[3] = _mm256_permute2f128_ps (u3, u7, 0x20);
+	r[4] = _mm256_permute2f128_ps (u0, u4, 0x31);
+	r[5] = _mm256_permute2f128_ps (u1, u5, 0x31);
+	r[6] = _mm256_permute2f128_ps (u2, u6, 0x31);
+	r[7] = _mm256_permute2f128_ps (u3, u7, 0x31);
+}
+
+TARGET_AVX2 static void deinterleave_8_avx2 (float* const* dst, const float* src, uint32_t n_samples)
+{
+	uint32_t s = 0;
+	for (; s + 8 <= n_samples; s += 8, src += 64) {
+		__m256 r[8];
+		for (uint32_t k = 0; k < 8; ++k) {
+			r[k] = _mm256_loadu_ps (src + 8 * k);
+		}
+		transpose_8x8 (r);
+		for (uint32_t c = 0; c < 8; ++c) {
+			_mm256_storeu_ps (dst[c] + s, r[c]);
+		}
+	}
+	_mm256_zeroupper ();
+	for (; s < n_samples; ++s) {
+		for (uint32_t c = 0; c < 8; ++c) {
+			dst[c][s] = *(src++);
+		}
+	}
+}
+
+TARGET_AVX2 static void interleave_8_avx2 (float* dst, float* const* src, uint32_t n_samples)
+{
+	uint32_t s = 0;
+	for (; s + 8 <= n_samples; s += 8, dst += 64) {
+		__m256 r[8];
+		for (uint32_t c = 0; c < 8; ++c) {
+			r[c] = _mm256_loadu_ps (src[c] + s);
+		}
+		transpose_8x8 (r);
+		for (uint32_t k = 0; k < 8; ++k) {
+			_mm256_storeu_ps (dst + 8 * k, r[k]);
+		}
+	}
+	_mm256_zeroupper ();
+	for (; s < n_samples; ++s) {
+		for (uint32_t c = 0; c < 8; ++c) {
+			*(dst++) = src[c][s];
+		}
+	}
+}
+
+#endif /* X86_KERNELS */
+
+/* ****************************************************************************
+ * ARM NEON
+ */
+
+#ifdef NEON_KERNELS
+
+static void deinterleave_2_neon (float* const* dst, const float* src, uint32_t n_samples)
+{
+	float* d0 = dst[0];
+	float* d1 = dst[1];
+	uint32_t s = 0;
+	for (; s + 4 <= n_samples; s += 4, src += 8) {
+		float32x4x2_t v = vld2q_f32 (src);
+		vst1q_f32 (d0 + s, v.val[0]);
+		vst1q_f32 (d1 + s, v.val[1]);
+	}
+	for (; s < n_samples; ++s, src += 2) {
+		d0[s] = src[0];
+		d1[s] = src[1];
+	}
+}
+
+static void interleave_2_neon (float* dst, float* const* src, uint32_t n_samples)
+{
+	const float* s0 = src[0];
+	const float* s1 = src[1];
+	uint32_t s = 0;
+	for (; s + 4 <= n_samples; s += 4, dst += 8) {
+		float32x4x2_t v;
+		v.val[0] = vld1q_f32 (s0 + s);
+		v.val[1] = vld1q_f32 (s1 + s);
+		vst2q_f32 (dst, v);
+	}
+	for (; s < n_samples; ++s, dst += 2) {
+		dst[0] = s0[s];
+		dst[1] = s1[s];
+	}
+}
+
+static void deinterleave_4_neon (float* const* dst, const float* src, uint32_t n_samples)
+{
+	uint32_t s = 0;
+	for (; s + 4 <= n_samples; s += 4, src += 16) {
+		float32x4x4_t v = vld4q_f32 (src);
+		vst1q_f32 (dst[0] + s, v.val[0]);
+		vst1q_f32 (dst[1] + s, v.val[1]);
+		vst1q_f32 (dst[2] + s, v.val[2]);
+		vst1q_f32 (dst[3] + s, v.val[3]);
+	}
+	for (; s < n_samples; ++s) {
+		for (uint32_t c = 0; c < 4; ++c) {
+			dst[c][s] = *(src++);
+		}
+	}
+}
+
+static void interleave_4_neon (float* dst, float* const* src, uint32_t n_samples)
+{
+	uint32_t s = 0;
+	for (; s + 4 <= n_samples; s += 4, dst += 16) {
+		float32x4x4_t v;
+		v.val[0] = vld1q_f32 (src[0] + s);
+		v.val[1] = vld1q_f32 (src[1] + s);
+		v.val[2] = vld1q_f32 (src[2] + s);
+		v.val[3] = vld1q_f32 (src[3] + s);
+		vst4q_f32 (dst, v);
+	}
+	for (; s < n_samples; ++s) {
+		for (uint32_t c = 0; c < 4; ++c) {
+			*(dst++) = src[c][s];
+		}
+	}
+}
+
+#endif /* NEON_KERNELS */
+
+/* ****************************************************************************
+ * runtime dispatch
+ */
+
+static DeinterleaveFn deinterleave_fn[MAX_KERNEL_CHN + 1] = {
+	deinterleave_n<0>, deinterleave_1,    deinterleave_n<2>,
+	deinterleave_n<3>, deinterleave_n<4>, deinterleave_n<5>,
+	deinterleave_n<6>, deinterleave_n<7>, deinterleave_n<8>
+};
+
+static InterleaveFn interleave_fn[MAX_KERNEL_CHN + 1] = {
+	interleave_n<0>, interleave_1,    interleave_n<2>,
+	interleave_n<3>, interleave_n<4>, interleave_n<5>,
+	interleave_n<6>, interleave_n<7>, interleave_n<8>
+};
+
+static void select_kernels ()
+{
+#ifdef X86_KERNELS
+	__builtin_cpu_init ();
+	if (__builtin_cpu_supports ("sse2")) {
+		deinterleave_fn[2] = deinterleave_2_sse2;
+		deinterleave_fn[4] = deinterleave_4_sse2;
+		deinterleave_fn[6] = deinterleave_6_sse2;
+		deinterleave_fn[8] = deinterleave_8_sse2;
+		interleave_fn[2]   = interleave_2_sse2;
+		interleave_fn[4]   = interleave_4_sse2;
+		interleave_fn[6]   = interleave_6_sse2;
+		interleave_fn[8]   = interleave_8_sse2;
+	}
+	if (__builtin_cpu_supports ("avx2")) {
+		deinterleave_fn[2] = deinterleave_2_avx2;
+		deinterleave_fn[8] = deinterleave_8_avx2;
+		interleave_fn[2]   = interleave_2_avx2;
+		interleave_fn[8]   = interleave_8_avx2;
+	}
+#endif
+#ifdef NEON_KERNELS
+	deinterleave_fn[2] = deinterleave_2_neon;
+	deinterleave_fn[4] = deinterleave_4_neon;
+	interleave_fn[2]   = interleave_2_neon;
+	interleave_fn[4]   = interleave_4_neon;
+#endif
+}
+
+/* the tables are only written once: other filter instances may be
+ * using them from their Process () while a new instance is opened */
+void interleave_init ()
+{
+	static vlc_mutex_t init_lock   = VLC_STATIC_MUTEX;
+	static bool        initialized = false;
+
+	vlc_mutex_lock (&init_lock);
+	if (!initialized) {
+		select_kernels ();
+		initialized = true;
+	}
+	vlc_mutex_unlock (&init_lock);
+}
+
+void deinterleave (float* const* dst, const float* src, uint32_t n_chn, uint32_t n_samples)
+{
+	if (n_chn <= MAX_KERNEL_CHN) {
+		deinterleave_fn[n_chn] (dst, src, n_samples);
+		return;
+	}
+	for (uint32_t s = 0; s < n_samples; ++s) {
+		for (uint32_t c = 0; c < n_chn; ++c) {
+			dst[c][s] = *(src++);
+		}
+	}
+}
+
+void interleave (float* dst, float* const* src, uint32_t n_chn, uint32_t n_samples)
+{
+	if (n_chn <= MAX_KERNEL_CHN) {
+		interleave_fn[n_chn] (dst, src, n_samples);
+		return;
+	}
+	for (uint32_t s = 0; s < n_samples; ++s) {
+		for (uint32_t c = 0; c < n_chn; ++c) {
+			*(dst++) = src[c][s];
+		}
+	}
+}
@@ -0,0 +1,34 @@
+/*
+ *  Copyright (C) 2016 Robin Gareus <robin@gareus.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _interleave_h_
+#define _interleave_h_
+
+#include <stdint.h>
+
+/* select the fastest kernels supported by the CPU, call before use.
+ * Only the first call has an effect */
+void interleave_init ();
+
+/* split interleaved `src` into `n_chn` planar buffers `dst[c][0..n_samples)` */
+void deinterleave (float* const* dst, const float* src, uint32_t n_chn, uint32_t n_samples);
+
+/* merge `n_chn` planar buffers `src[c][0..n_samples)` into interleaved `dst` */
+void interleave (float* dst, float* const* src, uint32_t n_chn, uint32_t n_samples);
+
+#endif
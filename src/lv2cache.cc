@@ -0,0 +1,343 @@
+/*
+ *  Copyright (C) 2016 Robin Gareus <robin@gareus.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "lilv_internal.h"
+
+#include "atomicfile.h"
+#include "lv2cache.h"
+
+/* File format, one record per line:
+ *   LV2VLC-CACHE <version> <host-version>
+ *   B <mtime> <bundle-path>
+ *   P <supported> <plugin-uri>\t<name>
+ *   R <preset-uri>\t<label>
+ * Plugin lines belong to the preceding bundle, preset lines to the
+ * preceding plugin.
+ * A cache written by a host with a different LV2CACHE_HOST_VERSION is
+ * discarded, which re-evaluates the support verdicts.
+ */
+#define CACHE_STR2(x) #x
+#define CACHE_STR(x) CACHE_STR2(x)
+#define CACHE_HEADER "LV2VLC-CACHE 2 " CACHE_STR(LV2CACHE_HOST_VERSION)
+
+static Lv2CacheBundle* add_bundle (Lv2Cache* cache, const char* path, int64_t mtime)
+{
+	Lv2CacheBundle* b = (Lv2CacheBundle*) realloc (cache->bundles, (cache->n_bundles + 1) * sizeof (Lv2CacheBundle));
+	if (!b) {
+		return NULL;
+	}
+	cache->bundles = b;
+	b = &cache->bundles[cache->n_bundles++];
+	b->path      = strdup (path);
+	b->mtime     = mtime;
+	b->plugins   = NULL;
+	b->n_plugins = 0;
+	return b;
+}
+
+static int cmp_bundle (const void* a, const void* b)
+{
+	return strcmp (((const Lv2CacheBundle*)a)->path, ((const Lv2CacheBundle*)b)->path);
+}
+
+/* ****************************************************************************
+ * scan LV2_PATH
+ */
+
+static void scan_file (const char* dir, const char* name, void* data)
+{
+	int64_t* latest = (int64_t*) data;
+	char* path = lilv_strjoin (dir, "/", name, NULL);
+	struct stat st;
+	if (stat (path, &st) == 0 && st.st_mtime > *latest) {
+		*latest = st.st_mtime;
+	}
+	free (path);
+}
+
+static void scan_bundle (const char* dir, const char* name, void* data)
+{
+	if (!strcmp (name, ".") || !strcmp (name, "..")) {
+		return;
+	}
+	Lv2Cache* cache = (Lv2Cache*) data;
+
+	/* same path as lilv uses for the bundle-URI */
+	char* path = lilv_strjoin (dir, "/", name, "/", NULL);
+	char* manifest = lilv_strjoin (path, "manifest.ttl", NULL);
+
+	struct stat st;
+	if (stat (manifest, &st) == 0) {
+		int64_t mtime = st.st_mtime;
+		if (stat (path, &st) == 0 && st.st_mtime > mtime) {
+			mtime = st.st_mtime;
+		}
+		/* files edited in-place do not touch the directory */
+		lilv_dir_for_each (path, &mtime, scan_file);
+		add_bundle (cache, path, mtime);
+	}
+	free (manifest);
+	free (path);
+}
+
+Lv2Cache* cache_scan ()
+{
+	Lv2Cache* cache = (Lv2Cache*) calloc (1, sizeof (Lv2Cache));
+	if (!cache) {
+		return NULL;
+	}
+
+	const char* lv2_path = getenv ("LV2_PATH");
+	if (!lv2_path) {
+		lv2_path = LILV_DEFAULT_LV2_PATH;
+	}
+
+	while (*lv2_path) {
+		size_t len = strcspn (lv2_path, LILV_PATH_SEP);
+		char* dir = (char*) malloc (len + 1);
+		memcpy (dir, lv2_path, len);
+		dir[len] = '\0';
+
+		char* path = lilv_expand (dir);
+		if (path) {
+			lilv_dir_for_each (path, cache, scan_bundle);
+			free (path);
+		}
+		free (dir);
+
+		lv2_path += len;
+		if (*lv2_path) {
+			++lv2_path;
+		}
+	}
+
+	qsort (cache->bundles, cache->n_bundles, sizeof (Lv2CacheBundle), cmp_bundle);
+	return cache;
+}
+
+/* ****************************************************************************
+ * read/write
+ */
+
+Lv2Cache* cache_read (const char* file)
+{
+	FILE* f = fopen (file, "rb");
+	if (!f) {
+		return NULL;
+	}
+
+	char* data = NULL;
+	long size = 0;
+	if (fseek (f, 0, SEEK_END) == 0 && (size = ftell (f)) > 0 && fseek (f, 0, SEEK_SET) == 0) {
+		data = (char*) malloc (size + 1);
+		if (data && fread (data, 1, size, f) != (size_t)size) {
+			free (data);
+			data = NULL;
+		}
+	}
+	fclose (f);
+
+	if (!data) {
+		return NULL;
+	}
+	data[size] = '\0';
+
+	Lv2Cache* cache = (Lv2Cache*) calloc (1, sizeof (Lv2Cache));
+	Lv2CacheBundle* bundle = NULL;
+	Lv2CachePlugin* plugin = NULL;
+	bool ok = cache != NULL;
+	bool header = false;
+
+	for (char* line = data; ok && line && *line; ) {
+		char* eol = strchr (line, '\n');
+		if (eol) {
+			*eol = '\0';
+		}
+
+		if (!header) {
+			ok = header = !strcmp (line, CACHE_HEADER);
+		} else if (line[0] == 'B' && line[1] == ' ') {
+			char* path;
+			long long mtime = strtoll (line + 2, &path, 10);
+			if (path == line + 2 || *path != ' ' || !path[1]) {
+				ok = false;
+			} else {
+				ok = (bundle = add_bundle (cache, path + 1, mtime)) != NULL;
+				plugin = NULL;
+			}
+		} else if (line[0] == 'P' && line[1] == ' ' && (line[2] == '0' || line[2] == '1') && line[3] == ' ') {
+			char* tab = strchr (line + 4, '\t');
+			if (!bundle || !tab) {
+				ok = false;
+			} else {
+				*tab = '\0';
+				plugin = cache_add_plugin (bundle, line + 4, tab + 1, line[2] == '1');
+			}
+		} else if (line[0] == 'R' && line[1] == ' ') {
+			char* tab = strchr (line + 2, '\t');
+			if (!plugin || !tab) {
+				ok = false;
+			} else {
+				*tab = '\0';
+				cache_add_preset (plugin, line + 2, tab + 1);
+			}
+		} else if (*line) {
+			ok = false;
+		}
+
+		line = eol ? eol + 1 : NULL;
+	}
+
+	free (data);
+
+	if (!ok || !header) {
+		cache_free (cache);
+		return NULL;
+	}
+	qsort (cache->bundles, cache->n_bundles, sizeof (Lv2CacheBundle), cmp_bundle);
+	return cache;
+}
+
+bool cache_write (const Lv2Cache* cache, const char* file)
+{
+	/* concurrent VLC processes each write their own file */
+	char* tmp = NULL;
+	FILE* f = atomic_write_open (file, &tmp);
+	if (!f) {
+		return false;
+	}
+
+	fprintf (f, "%s\n", CACHE_HEADER);
+	for (uint32_t i = 0; i < cache->n_bundles; ++i) {
+		const Lv2CacheBundle* b = &cache->bundles[i];
+		fprintf (f, "B %lld %s\n", (long long) b->mtime, b->path);
+		for (uint32_t p = 0; p < b->n_plugins; ++p) {
+			const Lv2CachePlugin* pl = &b->plugins[p];
+			fprintf (f, "P %d %s\t%s\n", pl->supported ? 1 : 0, pl->uri, pl->name);
+			for (uint32_t r = 0; r < pl->n_presets; ++r) {
+				fprintf (f, "R %s\t%s\n", pl->presets[r].uri, pl->presets[r].label);
+			}
+		}
+	}
+
+	return atomic_write_commit (f, tmp, file);
+}
+
+void cache_free (Lv2Cache* cache)
+{
+	if (!cache) {
+		return;
+	}
+	for (uint32_t i = 0; i < cache->n_bundles; ++i) {
+		Lv2CacheBundle* b = &cache->bundles[i];
+		for (uint32_t p = 0; p < b->n_plugins; ++p) {
+			for (uint32_t r = 0; r < b->plugins[p].n_presets; ++r) {
+				free (b->plugins[p].presets[r].uri);
+				free (b->plugins[p].presets[r].label);
+			}
+			free (b->plugins[p].presets);
+			free (b->plugins[p].uri);
+			free (b->plugins[p].name);
+		}
+		free (b->plugins);
+		free (b->path);
+	}
+	free (cache->bundles);
+	free (cache);
+}
+
+/* ****************************************************************************
+ * lookup
+ */
+
+bool cache_uptodate (const Lv2Cache* cache, const Lv2Cache* scan)
+{
+	if (cache->n_bundles != scan->n_bundles) {
+		return false;
+	}
+	for (uint32_t i = 0; i < cache->n_bundles; ++i) {
+		if (cache->bundles[i].mtime != scan->bundles[i].mtime
+				|| strcmp (cache->bundles[i].path, scan->bundles[i].path)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+Lv2CacheBundle* cache_find_bundle (const Lv2Cache* cache, const char* path)
+{
+	Lv2CacheBundle key;
+	key.path = (char*) path;
+	return (Lv2CacheBundle*) bsearch (&key, cache->bundles, cache->n_bundles, sizeof (Lv2CacheBundle), cmp_bundle);
+}
+
+const Lv2CachePlugin* cache_find_plugin (const Lv2CacheBundle* bundle, const char* uri)
+{
+	for (uint32_t p = 0; p < bundle->n_plugins; ++p) {
+		if (!strcmp (bundle->plugins[p].uri, uri)) {
+			return &bundle->plugins[p];
+		}
+	}
+	return NULL;
+}
+
+/* one record per line */
+static void sanitize (char* s)
+{
+	for (char* c = s; *c; ++c) {
+		if (*c == '\n' || *c == '\r' || *c == '\t') {
+			*c = ' ';
+		}
+	}
+}
+
+Lv2CachePlugin* cache_add_plugin (Lv2CacheBundle* bundle, const char* uri, const char* name, bool supported)
+{
+	Lv2CachePlugin* p = (Lv2CachePlugin*) realloc (bundle->plugins, (bundle->n_plugins + 1) * sizeof (Lv2CachePlugin));
+	if (!p) {
+		return NULL;
+	}
+	bundle->plugins = p;
+	p = &bundle->plugins[bundle->n_plugins++];
+	p->uri = strdup (uri);
+	p->name = strdup (name);
+	p->supported = supported;
+	p->presets = NULL;
+	p->n_presets = 0;
+	sanitize (p->name);
+	return p;
+}
+
+void cache_add_preset (Lv2CachePlugin* plugin, const char* uri, const char* label)
+{
+	Lv2CachePreset* r = (Lv2CachePreset*) realloc (plugin->presets, (plugin->n_presets + 1) * sizeof (Lv2CachePreset));
+	if (!r) {
+		return;
+	}
+	plugin->presets = r;
+	r = &plugin->presets[plugin->n_presets++];
+	r->uri = strdup (uri);
+	r->label = strdup (label);
+	sanitize (r->label);
+}
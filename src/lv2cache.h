@@ -0,0 +1,74 @@
+/*
+ *  Copyright (C) 2016 Robin Gareus <robin@gareus.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _lv2cache_h_
+#define _lv2cache_h_
+
+#include <stdint.h>
+
+/* on-disk cache of the plugin list, to skip parsing unmodified bundles */
+
+/* what the host supports, bump whenever verify_support () or the
+ * parser change which plugins are accepted */
+#define LV2CACHE_HOST_VERSION 1
+
+typedef struct {
+	char* uri;
+	char* label;
+} Lv2CachePreset;
+
+typedef struct {
+	char*           uri;
+	char*           name;
+	bool            supported;
+	Lv2CachePreset* presets;
+	uint32_t        n_presets;
+} Lv2CachePlugin;
+
+typedef struct {
+	char*           path;   // bundle directory, with trailing separator
+	int64_t         mtime;  // latest modification of the bundle dir or its files
+	Lv2CachePlugin* plugins;
+	uint32_t        n_plugins;
+} Lv2CacheBundle;
+
+typedef struct {
+	Lv2CacheBundle* bundles; // sorted by path
+	uint32_t        n_bundles;
+} Lv2Cache;
+
+/* list all bundles on the LV2_PATH with their mtime (no plugins) */
+Lv2Cache* cache_scan ();
+
+/* read a cache file, returns NULL if it does not exist or is invalid */
+Lv2Cache* cache_read (const char* file);
+
+/* atomically replace the cache file */
+bool cache_write (const Lv2Cache* cache, const char* file);
+
+void cache_free (Lv2Cache* cache);
+
+/* true if both list the same bundles with identical mtime */
+bool cache_uptodate (const Lv2Cache* cache, const Lv2Cache* scan);
+
+Lv2CacheBundle* cache_find_bundle (const Lv2Cache* cache, const char* path);
+const Lv2CachePlugin* cache_find_plugin (const Lv2CacheBundle* bundle, const char* uri);
+Lv2CachePlugin* cache_add_plugin (Lv2CacheBundle* bundle, const char* uri, const char* name, bool supported);
+void cache_add_preset (Lv2CachePlugin* plugin, const char* uri, const char* label);
+
+#endif
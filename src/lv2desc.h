@@ -58,6 +58,11 @@ struct LV2Port {
 	//const char* unit; // or format ?
 };
 
+struct LV2Preset {
+	char *uri;
+	char *path; // file to parse, rdfs:seeAlso of the preset
+};
+
 typedef struct _RtkLv2Description {
 	char* dsp_uri;
 	char* gui_uri;
@@ -86,8 +91,17 @@ typedef struct _RtkLv2Description {
 	uint32_t min_atom_bufsiz;
 	uint32_t latency_ctrl_port;
 	uint32_t enable_ctrl_port;
+	uint32_t freewheel_ctrl_port;
+
+	/* symbol -> port-index hash-table, open addressing, UINT32_MAX: empty */
+	uint32_t* symbol_index;
+	uint32_t  symbol_mask;
+
+	struct LV2Preset *presets;
+	uint32_t npresets;
 
 	bool     send_time_info;
 	bool     has_state_interface;
+	bool     requires_fixed_block;
 } RtkLv2Description;
 #endif
@@ -43,7 +43,7 @@ extern "C" {
 	char* lilv_dirname(const char* path);
 }
 
-LV2Plugin::LV2Plugin (RtkLv2Description* desc, float rate)
+LV2Plugin::LV2Plugin (RtkLv2Description* desc, Lv2UriMap& map, float rate, int32_t max_block_size, bool fixed_block_size)
 	: ctrl_to_ui (1 + UPDATE_FREQ_RATIO * desc->nports_ctrl)
 	, atom_to_ui (1 + UPDATE_FREQ_RATIO * desc->min_atom_bufsiz)
 	, atom_from_ui (UPDATE_FREQ_RATIO * desc->min_atom_bufsiz)
@@ -51,6 +51,10 @@ LV2Plugin::LV2Plugin (RtkLv2Description* desc, float rate)
 	, _plugin_dsp (0)
 	, _plugin_instance (0)
 	, _sample_rate (rate)
+	, _min_block_size (fixed_block_size ? max_block_size : 1)
+	, _max_block_size (max_block_size)
+	, _fixed_block_size (fixed_block_size)
+	, _map (map)
 	, _ui (this)
 	, _worker (0)
 	, worker_iface (0)
@@ -67,8 +71,18 @@ LV2Plugin::LV2Plugin (RtkLv2Description* desc, float rate)
 		throw -1;
 	}
 
-	_ports = (float*) malloc (_desc->nports_total * sizeof (float));
-	_ports_pre = (float*) malloc (_desc->nports_total * sizeof (float));
+	_ports         = (float*) calloc (_desc->nports_ctrl + 1, sizeof (float));
+	_ctrl_in       = _ports;
+	_ctrl_out      = _ports + _desc->nports_ctrl_in;
+	_ctrl_out_ui   = (float*) calloc (_desc->nports_ctrl_out + 1, sizeof (float));
+	_ctrl_in_port  = (uint32_t*) calloc (_desc->nports_ctrl_in + 1, sizeof (uint32_t));
+	_ctrl_out_port = (uint32_t*) calloc (_desc->nports_ctrl_out + 1, sizeof (uint32_t));
+	_ctrl_slot     = (uint32_t*) calloc (_desc->nports_total, sizeof (uint32_t));
+
+	_audio_in_port  = (uint32_t*) calloc (_desc->nports_audio_in, sizeof (uint32_t));
+	_audio_out_port = (uint32_t*) calloc (_desc->nports_audio_out, sizeof (uint32_t));
+	_audio_in_buf   = (float**) calloc (_desc->nports_audio_in, sizeof (float*));
+	_audio_out_buf  = (float**) calloc (_desc->nports_audio_out, sizeof (float*));
 
 	_atom_in = (LV2_Atom_Sequence*) malloc (_desc->min_atom_bufsiz + sizeof (uint8_t));
 	_atom_out = (LV2_Atom_Sequence*) malloc (_desc->min_atom_bufsiz + sizeof (uint8_t));
@@ -89,25 +103,33 @@ void LV2Plugin::init ()
 {
 
 	_uri.atom_Float           = _map.uri_to_id (LV2_ATOM__Float);
+	_uri.atom_Double          = _map.uri_to_id (LV2_ATOM__Double);
 	_uri.atom_Int             = _map.uri_to_id (LV2_ATOM__Int);
+	_uri.atom_Long            = _map.uri_to_id (LV2_ATOM__Long);
 	_uri.param_sampleRate     = _map.uri_to_id (LV2_PARAMETERS__sampleRate);
 	_uri.bufsz_minBlockLength = _map.uri_to_id (LV2_BUF_SIZE__minBlockLength);
 	_uri.bufsz_maxBlockLength = _map.uri_to_id (LV2_BUF_SIZE__maxBlockLength);
+	_uri.bufsz_nominalBlockLength = _map.uri_to_id (LV2_BUF_SIZE__nominalBlockLength);
 	_uri.bufsz_sequenceSize   = _map.uri_to_id (LV2_BUF_SIZE__sequenceSize);
 
-	/* options to pass to plugin */
+	/* options to pass to plugin.
+	 * Only with a fixed block-size is the nominal length known,
+	 * otherwise its entry terminates the list early */
+	const LV2_Options_Option nominal_option = { LV2_OPTIONS_INSTANCE, 0, _uri.bufsz_nominalBlockLength,
+		sizeof(int32_t), _uri.atom_Int, &_max_block_size };
+	const LV2_Options_Option end_option = { LV2_OPTIONS_INSTANCE, 0, 0, 0, 0, NULL };
+
 	const LV2_Options_Option options[] = {
 		{ LV2_OPTIONS_INSTANCE, 0, _uri.param_sampleRate,
 			sizeof(float), _uri.atom_Float, &_sample_rate },
-#if 0
 		{ LV2_OPTIONS_INSTANCE, 0, _uri.bufsz_minBlockLength,
-			sizeof(int32_t), _uri.atom_Int, &_block_size },
+			sizeof(int32_t), _uri.atom_Int, &_min_block_size },
 		{ LV2_OPTIONS_INSTANCE, 0, _uri.bufsz_maxBlockLength,
-			sizeof(int32_t), _uri.atom_Int, &_block_size },
-#endif
+			sizeof(int32_t), _uri.atom_Int, &_max_block_size },
 		{ LV2_OPTIONS_INSTANCE, 0, _uri.bufsz_sequenceSize,
 			sizeof(int32_t), _uri.atom_Int, &atom_buf_size },
-		{ LV2_OPTIONS_INSTANCE, 0, 0, 0, 0, NULL }
+		_fixed_block_size ? nominal_option : end_option,
+		end_option
 	};
 
 	/* lv2 host features */
@@ -115,12 +137,18 @@ void LV2Plugin::init ()
 	const LV2_Feature map_feature      = { LV2_URID__map, &uri_map};
 	const LV2_Feature unmap_feature    = { LV2_URID__unmap, &uri_unmap };
 	const LV2_Feature options_feature  = { LV2_OPTIONS__options, (void*)&options };
+	const LV2_Feature bounded_feature  = { LV2_BUF_SIZE__boundedBlockLength, NULL };
+	const LV2_Feature fixed_feature    = { LV2_BUF_SIZE__fixedBlockLength, NULL };
+	const LV2_Feature pow2_feature     = { LV2_BUF_SIZE__powerOf2BlockLength, NULL };
 
 	const LV2_Feature* features[] = {
 		&map_feature,
 		&unmap_feature,
 		&schedule_feature,
 		&options_feature,
+		&bounded_feature,
+		_fixed_block_size ? &fixed_feature : NULL,
+		_fixed_block_size ? &pow2_feature : NULL,
 		NULL
 	};
 
@@ -151,20 +179,29 @@ void LV2Plugin::init ()
 	/* connect ports */
 	uint32_t c_ain  = 0;
 	uint32_t c_aout = 0;
+	uint32_t c_cin  = 0;
+	uint32_t c_cout = 0;
 
 	for (uint32_t p=0; p < _desc->nports_total; ++p) {
+		_ctrl_slot[p] = UINT32_MAX;
 		switch (_desc->ports[p].porttype) {
 			case CONTROL_IN:
-				_ports[p] = _desc->ports[p].val_default;
-				//printf ("CTRL %d = %f # %s\n", p, _ports[p], _desc->ports[p].name);
-				_plugin_dsp->connect_port (_plugin_instance, p, &_ports[p]);
+				_ctrl_slot[p] = c_cin;
+				_ctrl_in_port[c_cin] = p;
+				_ctrl_in[c_cin] = _desc->ports[p].val_default;
+				//printf ("CTRL %d = %f # %s\n", p, _ctrl_in[c_cin], _desc->ports[p].name);
+				_plugin_dsp->connect_port (_plugin_instance, p, &_ctrl_in[c_cin]);
 				{
-					ParamVal pv (p, _ports[p]);
+					ParamVal pv (p, _ctrl_in[c_cin]);
 					ctrl_to_ui.write (&pv, 1);
 				}
+				++c_cin;
 				break;
 			case CONTROL_OUT:
-				_plugin_dsp->connect_port (_plugin_instance, p, &_ports[p]);
+				_ctrl_slot[p] = c_cout;
+				_ctrl_out_port[c_cout] = p;
+				_plugin_dsp->connect_port (_plugin_instance, p, &_ctrl_out[c_cout]);
+				++c_cout;
 				break;
 			case MIDI_IN:
 			case ATOM_IN:
@@ -177,9 +214,13 @@ void LV2Plugin::init ()
 				_plugin_dsp->connect_port (_plugin_instance, p, _atom_out);
 				break;
 			case AUDIO_IN:
+				_audio_in_port[c_ain] = p;
+				_audio_in_buf[c_ain] = NULL;
 				++c_ain;
 				break;
 			case AUDIO_OUT:
+				_audio_out_port[c_aout] = p;
+				_audio_out_buf[c_aout] = NULL;
 				++c_aout;
 				break;
 			default:
@@ -187,6 +228,8 @@ void LV2Plugin::init ()
 		}
 	}
 
+	assert (c_cin == _desc->nports_ctrl_in);
+	assert (c_cout == _desc->nports_ctrl_out);
 	assert (c_ain == _desc->nports_audio_in);
 	assert (c_aout == _desc->nports_audio_out);
 
@@ -204,7 +247,7 @@ void LV2Plugin::init ()
 	}
 
 	if (worker_iface) {
-		_worker = new Lv2Worker (worker_iface, _plugin_instance);
+		_worker = new Lv2Worker (worker_iface, _plugin_instance, _desc->min_atom_bufsiz);
 		schedule.handle = _worker;
 	}
 }
@@ -225,7 +268,14 @@ LV2Plugin::~LV2Plugin ()
 	deinit ();
 
 	free (_ports);
-	free (_ports_pre);
+	free (_ctrl_out_ui);
+	free (_ctrl_in_port);
+	free (_ctrl_out_port);
+	free (_ctrl_slot);
+	free (_audio_in_port);
+	free (_audio_out_port);
+	free (_audio_in_buf);
+	free (_audio_out_buf);
 	free (_atom_in);
 	free (_atom_out);
 	free_desc (_desc);
@@ -237,21 +287,43 @@ LV2Plugin::~LV2Plugin ()
  */
 bool LV2Plugin::set_parameter (int32_t p, float val)
 {
-	if (_ports[p] == val) {
+	assert (_desc->ports[p].porttype == CONTROL_IN);
+	float& port = _ctrl_in[_ctrl_slot[p]];
+
+	if (port == val) {
 		return false;
 	}
 
-	_ports[p] = val;
+	port = val;
 
 	if (_ui.is_open ()) {
 		if (ctrl_to_ui.write_space () > 0) {
-			ParamVal pv (p, _ports[p]);
+			ParamVal pv (p, port);
 			ctrl_to_ui.write (&pv, 1);
 		}
 	}
 	return true;
 }
 
+/* copy all control input values from another instance of the same plugin */
+void LV2Plugin::link_controls (LV2Plugin const& master)
+{
+	assert (master._desc->nports_ctrl_in == _desc->nports_ctrl_in);
+	memcpy (_ctrl_in, master._ctrl_in, _desc->nports_ctrl_in * sizeof (float));
+}
+
+/* offline processing: run the worker synchronously, and tell the plugin
+ * via its lv2:freeWheeling port. Must not be called while processing. */
+void LV2Plugin::set_freewheeling (bool yn)
+{
+	if (_worker) {
+		_worker->set_freewheeling (yn);
+	}
+	if (_desc->freewheel_ctrl_port != UINT32_MAX) {
+		set_parameter (_desc->freewheel_ctrl_port, yn ? 1.f : 0.f);
+	}
+}
+
 /* ****************************************************************************
  * State
  */
@@ -284,20 +356,20 @@ void LV2Plugin::suspend ()
 
 void LV2Plugin::process (float** iobuf, int32_t n_samples)
 {
-	int ins = 0;
-	int outs = 0;
-
-	/* re-connect audio buffers */
-	for (uint32_t p = 0; p < _desc->nports_total; ++p) {
-		switch (_desc->ports[p].porttype) {
-			case AUDIO_IN:
-				_plugin_dsp->connect_port (_plugin_instance, p, iobuf[ins++]);
-				break;
-			case AUDIO_OUT:
-				_plugin_dsp->connect_port (_plugin_instance, p, iobuf[outs++]);
-				break;
-			default:
-				break;
+	/* plugins must not block the processing thread when mapping URIs */
+	Lv2UriMap::RtScope rt_scope;
+
+	/* re-connect audio buffers, if they changed */
+	for (uint32_t i = 0; i < _desc->nports_audio_in; ++i) {
+		if (_audio_in_buf[i] != iobuf[i]) {
+			_audio_in_buf[i] = iobuf[i];
+			_plugin_dsp->connect_port (_plugin_instance, _audio_in_port[i], iobuf[i]);
+		}
+	}
+	for (uint32_t i = 0; i < _desc->nports_audio_out; ++i) {
+		if (_audio_out_buf[i] != iobuf[i]) {
+			_audio_out_buf[i] = iobuf[i];
+			_plugin_dsp->connect_port (_plugin_instance, _audio_out_port[i], iobuf[i]);
 		}
 	}
 
@@ -312,17 +384,22 @@ void LV2Plugin::process (float** iobuf, int32_t n_samples)
 		uint8_t* seq = (uint8_t*) (body + 1);
 
 		if (_ui.has_editor ()) {
-			while (atom_from_ui.read_space () > sizeof (LV2_Atom)) {
-				LV2_Atom a;
-				atom_from_ui.read ((char *) &a, sizeof (LV2_Atom));
-				uint32_t padded_size = _atom_in->atom.size + a.size + sizeof (int64_t);
-				if (_desc->min_atom_bufsiz > padded_size) {
+			/* each message is one atom, append it as event at time 0 */
+			uint32_t size;
+			const void* atom;
+			while ((atom = atom_from_ui.peek (&size))) {
+				const uint32_t ev_size = sizeof (int64_t) + ((size + 7) & ~7);
+				if (_atom_in->atom.size + ev_size + sizeof (LV2_Atom) > _desc->min_atom_bufsiz) {
+					if (_atom_in->atom.size > 8) {
+						break; // retry next cycle
+					}
+				} else {
 					memset (seq, 0, sizeof (int64_t)); // LV2_Atom_Event->time
-					seq += sizeof (int64_t);
-					atom_from_ui.read ((char *) seq, a.size);
-					seq += a.size;
-					_atom_in->atom.size += a.size + sizeof (int64_t);
+					memcpy (seq + sizeof (int64_t), atom, size);
+					seq += ev_size;
+					_atom_in->atom.size += ev_size;
 				}
+				atom_from_ui.consume ();
 			}
 		}
 	}
@@ -332,9 +409,6 @@ void LV2Plugin::process (float** iobuf, int32_t n_samples)
 		_atom_out->atom.size = _desc->min_atom_bufsiz;
 	}
 
-	/* make a backup copy, to see what is changed */
-	memcpy (_ports_pre, _ports, _desc->nports_total * sizeof (float));
-
 	_plugin_dsp->run (_plugin_instance, n_samples);
 
 	/* handle worker emit response  - may amend Atom seq... */
@@ -344,28 +418,27 @@ void LV2Plugin::process (float** iobuf, int32_t n_samples)
 
 	/* create port-events for changed values */
 	if (_ui.is_open ()) {
-		for (uint32_t p = 0; p < _desc->nports_total; ++p) {
-			if (_desc->ports[p].porttype == CONTROL_IN && _ui_sync) {
-				ParamVal pv (p, _ports[p]);
+		if (_ui_sync) {
+			for (uint32_t i = 0; i < _desc->nports_ctrl_in; ++i) {
+				ParamVal pv (_ctrl_in_port[i], _ctrl_in[i]);
 				ctrl_to_ui.write (&pv, 1);
-				continue;
-			}
-			if (_desc->ports[p].porttype != CONTROL_OUT) {
-				continue;
 			}
-			if (_ports_pre[p] == _ports[p] && !_ui_sync) {
-				continue;
-			}
-
-			if (p == _desc->latency_ctrl_port) {
-				//
-			}
-
-			if (ctrl_to_ui.write_space () < 1) {
-				continue;
+		}
+		/* output values are compared to what was last sent to the UI,
+		 * a changed value that does not fit is retried next cycle. */
+		const uint32_t n_out = _desc->nports_ctrl_out;
+		if (_ui_sync || memcmp (_ctrl_out_ui, _ctrl_out, n_out * sizeof (float))) {
+			for (uint32_t i = 0; i < n_out; ++i) {
+				if (!_ui_sync && !memcmp (&_ctrl_out_ui[i], &_ctrl_out[i], sizeof (float))) {
+					continue;
+				}
+				if (ctrl_to_ui.write_space () < 1) {
+					break;
+				}
+				ParamVal pv (_ctrl_out_port[i], _ctrl_out[i]);
+				ctrl_to_ui.write (&pv, 1);
+				_ctrl_out_ui[i] = _ctrl_out[i];
 			}
-			ParamVal pv (p, _ports[p]);
-			ctrl_to_ui.write (&pv, 1);
 		}
 		_ui_sync = false;
 	} else {
@@ -374,11 +447,9 @@ void LV2Plugin::process (float** iobuf, int32_t n_samples)
 
 	/* Atom sequence port-events */
 	if (_desc->nports_atom_out + _desc->nports_midi_out > 0 && _atom_out->atom.size > sizeof (LV2_Atom)) {
-		if (_ui.is_open () && atom_to_ui.write_space () >= _atom_out->atom.size + 2 * sizeof (LV2_Atom)) {
-			LV2_Atom a = {_atom_out->atom.size + (uint32_t) sizeof (LV2_Atom), 0};
-
-			atom_to_ui.write ((char *) &a, sizeof (LV2_Atom));
-			atom_to_ui.write ((char *) _atom_out, a.size);
+		if (_ui.is_open ()) {
+			/* the sequence is dropped if the UI does not keep up */
+			atom_to_ui.write (_atom_out, _atom_out->atom.size + sizeof (LV2_Atom));
 		}
 	}
 
@@ -44,11 +44,14 @@ struct URIs {
 	LV2_URID atom_EventTransfer;
 
 	LV2_URID atom_Float;
+	LV2_URID atom_Double;
 	LV2_URID atom_Int;
+	LV2_URID atom_Long;
 
 	LV2_URID param_sampleRate;
 	LV2_URID bufsz_minBlockLength;
 	LV2_URID bufsz_maxBlockLength;
+	LV2_URID bufsz_nominalBlockLength;
 	LV2_URID bufsz_sequenceSize;
 };
 
@@ -103,7 +106,6 @@ class LV2PluginUI
 		LV2UI_Resize   lv2ui_resize;
 
 		LV2UI_Idle_Interface* _idle_iface;
-		LV2_Atom_Sequence* _atombuf;
 		LV2_URID _uri_atom_EventTransfer;
 
 		int  _width;
@@ -116,19 +118,27 @@ class LV2PluginUI
 class LV2Plugin
 {
 	public:
-		LV2Plugin (RtkLv2Description*, float rate);
+		LV2Plugin (RtkLv2Description*, Lv2Vlc::Lv2UriMap&, float rate, int32_t max_block_size, bool fixed_block_size);
 		~LV2Plugin ();
 
 		void process (float**, int32_t);
 
 		bool set_parameter (int32_t, float);
+		void link_controls (LV2Plugin const&);
+		void set_freewheeling (bool);
 		LV2PluginUI& ui () { return _ui; }
+		const char* uri () const { return _desc->dsp_uri; }
 
 		void resume ();
 		void suspend ();
 
 		int32_t save_state (void** data);
-		int32_t load_state (void* data, int32_t size);
+		int32_t load_state (const void* data, int32_t size);
+
+		bool has_preset (const char* uri) const;
+		/* parse the preset once and restore it on all given instances,
+		 * which must share the URI map */
+		static bool load_preset (LV2Plugin* const* plugins, unsigned int n_plugins, const char* uri);
 
 		struct LV2PortProperty {
 			uint32_t key;
@@ -148,6 +158,8 @@ class LV2Plugin
 			uint32_t         n_values;
 			LV2PortProperty* props;
 			LV2PortValue*    values;
+			uint32_t*        prop_index; // key -> props[], open addressing, UINT32_MAX: empty
+			uint32_t         prop_mask;
 		};
 
 	private:
@@ -168,8 +180,8 @@ class LV2Plugin
 		};
 
 		Lv2VlcUtil::RingBuffer<struct ParamVal> ctrl_to_ui;
-		Lv2VlcUtil::RingBuffer<char> atom_to_ui;
-		Lv2VlcUtil::RingBuffer<char> atom_from_ui;
+		Lv2VlcUtil::MessageRing atom_to_ui;
+		Lv2VlcUtil::MessageRing atom_from_ui;
 
 		void* map_instance () const { return (void*)&_map; }
 		LV2_URID map_uri (const char* uri) {
@@ -180,16 +192,20 @@ class LV2Plugin
 		void init ();
 		void deinit ();
 
-		size_t serialize_state (LV2State* state, void** data);
-		LV2State* unserialize_state (void* data, size_t s);
+		LV2State* unserialize_state (const void* data, size_t s);
+		void restore_port (const char* symbol, float value);
+		static void set_preset_value (const char* symbol, void* handle, const void* value, uint32_t size, uint32_t type);
 
 		RtkLv2Description*     _desc;
 		const LV2_Descriptor*  _plugin_dsp;
 		LV2_Handle             _plugin_instance;
 
-		float _sample_rate;
+		float   _sample_rate;
+		int32_t _min_block_size;
+		int32_t _max_block_size;
+		bool    _fixed_block_size;
 
-		Lv2Vlc::Lv2UriMap  _map;
+		Lv2Vlc::Lv2UriMap& _map;
 		LV2PluginUI        _ui;
 		Lv2Vlc::Lv2Worker* _worker;
 		URIs               _uri;
@@ -206,8 +222,20 @@ class LV2Plugin
 		uint32_t _portmap_atom_to_ui;
 		uint32_t _portmap_atom_from_ui;
 
-		float* _ports;
-		float* _ports_pre;
+		/* control port values: all inputs, followed by all outputs */
+		float*    _ports;
+		float*    _ctrl_in;
+		float*    _ctrl_out;
+		float*    _ctrl_out_ui;   // output values last sent to the UI
+		uint32_t* _ctrl_in_port;  // slot -> port-index
+		uint32_t* _ctrl_out_port;
+		uint32_t* _ctrl_slot;     // port-index -> slot in _ctrl_in or _ctrl_out
+
+		/* audio port indices and currently connected buffers */
+		uint32_t* _audio_in_port;
+		uint32_t* _audio_out_port;
+		float**   _audio_in_buf;
+		float**   _audio_out_buf;
 
 		bool _ui_sync;
 		bool _active;
@@ -46,7 +46,6 @@ LV2PluginUI::LV2PluginUI (LV2Plugin* effect)
 	, gui_instance (0)
 	, _widget (0)
 	, _idle_iface (0)
-	, _atombuf (0)
 	, _width (100)
 	, _height (100)
 	, _queue_resize (false)
@@ -74,7 +73,6 @@ LV2PluginUI::LV2PluginUI (LV2Plugin* effect)
 		return;
 	}
 
-	_atombuf = (LV2_Atom_Sequence*) malloc (desc->min_atom_bufsiz * sizeof (uint8_t));
 	_uri_atom_EventTransfer = _lv2plugin->map_uri (LV2_ATOM__eventTransfer);
 }
 
@@ -83,7 +81,6 @@ LV2PluginUI::~LV2PluginUI ()
 	if (plugin_gui && gui_instance && plugin_gui->cleanup) {
 		plugin_gui->cleanup (gui_instance);
 	}
-	free (_atombuf);
 	close_lv2_lib (_lib_handle);
 }
 
@@ -162,17 +159,19 @@ void LV2PluginUI::idle ()
 
 	const uint32_t portmap_atom_to_ui = _lv2plugin->portmap_atom_to_ui ();
 
-	while (_lv2plugin->atom_to_ui.read_space () > sizeof (LV2_Atom) && portmap_atom_to_ui != UINT32_MAX) {
-		LV2_Atom a;
-		_lv2plugin->atom_to_ui.read ((char *) &a, sizeof (LV2_Atom));
-		_lv2plugin->atom_to_ui.read ((char *) _atombuf, a.size);
-		LV2_Atom_Event const* ev = (LV2_Atom_Event const*)((&(_atombuf)->body) + 1); // lv2_atom_sequence_begin
-		while ((const uint8_t*)ev < ((const uint8_t*) &(_atombuf)->body + (_atombuf)->atom.size)) {
+	uint32_t size;
+	const void* msg;
+	while (portmap_atom_to_ui != UINT32_MAX && (msg = _lv2plugin->atom_to_ui.peek (&size))) {
+		/* events are passed on straight from the ringbuffer */
+		const LV2_Atom_Sequence* seq = (const LV2_Atom_Sequence*) msg;
+		LV2_Atom_Event const* ev = (LV2_Atom_Event const*)(&seq->body + 1); // lv2_atom_sequence_begin
+		while ((const uint8_t*)ev < ((const uint8_t*) &seq->body + seq->atom.size)) {
 			plugin_gui->port_event (gui_instance, portmap_atom_to_ui,
 					ev->body.size, _uri_atom_EventTransfer, &ev->body);
 			ev = (LV2_Atom_Event const*) /* lv2_atom_sequence_next() */
 				((const uint8_t*)ev + sizeof (LV2_Atom_Event) + ((ev->body.size + 7) & ~7));
 		}
+		_lv2plugin->atom_to_ui.consume ();
 	}
 
 	if (_idle_iface) {
@@ -184,11 +183,7 @@ void
 LV2PluginUI::write_to_dsp (uint32_t port_index, uint32_t buffer_size, uint32_t port_protocol, const void* buffer)
 {
 	if (port_protocol != 0) {
-		if (_lv2plugin->atom_from_ui.write_space () >= buffer_size + sizeof (LV2_Atom)) {
-			LV2_Atom a = {buffer_size, 0};
-			_lv2plugin->atom_from_ui.write ((char *) &a, sizeof (LV2_Atom));
-			_lv2plugin->atom_from_ui.write ((char *) buffer, buffer_size);
-		}
+		_lv2plugin->atom_from_ui.write (buffer, buffer_size);
 		return;
 	}
 
@@ -34,16 +34,23 @@
 #include "lv2/lv2plug.in/ns/lv2core/lv2.h"
 #include "lv2/lv2plug.in/ns/extensions/ui/ui.h"
 #include "lv2/lv2plug.in/ns/ext/atom/atom.h"
+#include "lv2/lv2plug.in/ns/ext/buf-size/buf-size.h"
 #include "lv2/lv2plug.in/ns/ext/event/event.h"
 #include "lv2/lv2plug.in/ns/ext/midi/midi.h"
 #include "lv2/lv2plug.in/ns/ext/resize-port/resize-port.h"
 #include "lv2/lv2plug.in/ns/ext/state/state.h"
 #include "lv2/lv2plug.in/ns/ext/time/time.h"
 #include "lv2/lv2plug.in/ns/ext/port-props/port-props.h"
+#include "lv2/lv2plug.in/ns/ext/presets/presets.h"
 
 #include "lilv/lilv.h"
+#include "serd/serd.h"
+
+#include <vlc_common.h>
+#include <vlc_threads.h>
 
 #include "loadlib.h"
+#include "lv2cache.h"
 #include "lv2ttl.h"
 
 #ifndef UINT32_MAX
@@ -83,7 +90,9 @@ static char* file_strdup (const LilvNode* val)
 	if (!lib_path) {
 		return strdup ("");
 	}
-	return strdup (lib_path);
+	char* rv = strdup (lib_path);
+	lilv_free (lib_path);
+	return rv;
 }
 
 static enum PortType type_to_enum (int type, int direction)
@@ -107,12 +116,72 @@ static enum PortType type_to_enum (int type, int direction)
 	return CONTROL_IN;
 }
 
+/* shared world */
+
+/* Loading the world scans all bundles on the LV2_PATH. This is done on
+ * first use and the world is shared by lv2ls () and get_desc_by_uri ().
+ * It is kept for the lifetime of the process, to not reload it for every
+ * Open: VLC does not notify a module when it is unloaded.
+ * lilv is not thread-safe, all access happens with world_lock held. */
+static vlc_mutex_t world_lock   = VLC_STATIC_MUTEX;
+static LilvWorld*  shared_world = NULL;
+
+static LilvWorld* world_get ()
+{
+	if (!shared_world) {
+		shared_world = lilv_world_new ();
+		LilvNode* parallel = lilv_new_bool (shared_world, true);
+		lilv_world_set_option (shared_world, LILV_OPTION_PARALLEL_LOAD, parallel);
+		lilv_node_free (parallel);
+		lilv_world_load_all (shared_world);
+	}
+	return shared_world;
+}
+
+/* port symbol index */
+
+static uint32_t symbol_hash (const char* s)
+{
+	/* FNV-1a */
+	uint32_t h = 2166136261U;
+	for (; *s; ++s) {
+		h = (h ^ (uint8_t)*s) * 16777619U;
+	}
+	return h;
+}
+
+static void index_symbols (RtkLv2Description* desc)
+{
+	uint32_t n = 4;
+	while (n < 2 * desc->nports_total) {
+		n <<= 1;
+	}
+	free (desc->symbol_index);
+	desc->symbol_index = (uint32_t*) malloc (n * sizeof (uint32_t));
+	if (!desc->symbol_index) {
+		return;
+	}
+	memset (desc->symbol_index, 0xff, n * sizeof (uint32_t));
+	desc->symbol_mask = n - 1;
+
+	for (uint32_t p = 0; p < desc->nports_total; ++p) {
+		if (!desc->ports[p].symbol) {
+			continue;
+		}
+		uint32_t h = symbol_hash (desc->ports[p].symbol) & desc->symbol_mask;
+		while (desc->symbol_index[h] != UINT32_MAX) {
+			h = (h + 1) & desc->symbol_mask;
+		}
+		desc->symbol_index[h] = p;
+	}
+}
+
 /* parser */
 
 class LV2Parser
 {
 	public:
-		LV2Parser (RtkLv2Description*);
+		LV2Parser (RtkLv2Description*, LilvWorld*);
 		~LV2Parser ();
 
 		int parse (const char* uri);
@@ -153,17 +222,17 @@ class LV2Parser
 		LilvNode* ext_causesArtifacts;
 		LilvNode* ext_notAutomatic;
 		LilvNode* lv2_enabled;
+		LilvNode* lv2_freeWheeling;
 		LilvNode* lv2_InputPort;
 		LilvNode* lv2_inPlaceBroken;
+		LilvNode* pset_Preset;
+		LilvNode* rdfs_seeAlso;
 };
 
-LV2Parser::LV2Parser (RtkLv2Description* d)
-	: desc (d)
+LV2Parser::LV2Parser (RtkLv2Description* d, LilvWorld* w)
+	: world (w)
+	, desc (d)
 {
-	world = lilv_world_new ();
-
-	lilv_world_load_all (world);
-
 	uri_atom_supports   = lilv_new_uri (world, LV2_ATOM__supports);
 	rsz_minimumSize     = lilv_new_uri (world, LV2_RESIZE_PORT__minimumSize);
 	uri_midi_event      = lilv_new_uri (world, LV2_MIDI__MidiEvent);
@@ -183,8 +252,11 @@ LV2Parser::LV2Parser (RtkLv2Description* d)
 	ext_causesArtifacts = lilv_new_uri (world, LV2_PORT_PROPS__causesArtifacts);
 	ext_notAutomatic    = lilv_new_uri (world, LV2_PORT_PROPS__notAutomatic);
 	lv2_enabled         = lilv_new_uri (world, LV2_CORE_PREFIX "enabled");
+	lv2_freeWheeling    = lilv_new_uri (world, LV2_CORE__freeWheeling);
 	lv2_InputPort       = lilv_new_uri (world, LILV_URI_INPUT_PORT);
 	lv2_inPlaceBroken   = lilv_new_uri(world, LV2_CORE__inPlaceBroken);
+	pset_Preset         = lilv_new_uri (world, LV2_PRESETS__Preset);
+	rdfs_seeAlso        = lilv_new_uri (world, LILV_NS_RDFS "seeAlso");
 }
 
 LV2Parser::~LV2Parser ()
@@ -208,9 +280,11 @@ LV2Parser::~LV2Parser ()
 	lilv_node_free (ext_causesArtifacts);
 	lilv_node_free (ext_notAutomatic);
 	lilv_node_free (lv2_enabled);
+	lilv_node_free (lv2_freeWheeling);
 	lilv_node_free (lv2_InputPort);
 	lilv_node_free (lv2_inPlaceBroken);
-	lilv_world_free (world);
+	lilv_node_free (pset_Preset);
+	lilv_node_free (rdfs_seeAlso);
 }
 
 int LV2Parser::parse (const char* plugin_uri)
@@ -239,9 +313,11 @@ int LV2Parser::parse (const char* plugin_uri, const LilvPlugin* p)
 
 	desc->send_time_info = false;
 	desc->has_state_interface = false;
+	desc->requires_fixed_block = false;
 	desc->min_atom_bufsiz = 8192;
 	desc->latency_ctrl_port = UINT32_MAX;
 	desc->enable_ctrl_port = UINT32_MAX;
+	desc->freewheel_ctrl_port = UINT32_MAX;
 
 	desc->plugin_name = node_strdup (lilv_plugin_get_name (p));
 	desc->vendor      = node_strdup (lilv_plugin_get_author_name (p));
@@ -292,6 +368,11 @@ int LV2Parser::parse (const char* plugin_uri, const LilvPlugin* p)
 			if (!strcmp (rf, "http://lv2plug.in/ns/ext/urid#unmap")) { ok = true; }
 			if (!strcmp (rf, "http://lv2plug.in/ns/ext/worker#schedule")) { ok = true; }
 			if (!strcmp (rf, "http://lv2plug.in/ns/ext/options#options")) { ok = true; }
+			if (!strcmp (rf, LV2_BUF_SIZE__boundedBlockLength)) { ok = true; }
+			if (!strcmp (rf, LV2_BUF_SIZE__fixedBlockLength) || !strcmp (rf, LV2_BUF_SIZE__powerOf2BlockLength)) {
+				desc->requires_fixed_block = true;
+				ok = true;
+			}
 			if (!ok) {
 				fprintf (stderr, "Unsupported required feature: '%s' in '%s'\n", rf, plugin_uri);
 				err = 1;
@@ -500,6 +581,7 @@ int LV2Parser::parse (const char* plugin_uri, const LilvPlugin* p)
 
 	desc->nports_total = num_ports;
 	desc->nports_ctrl = desc->nports_ctrl_in + desc->nports_ctrl_out;
+	index_symbols (desc);
 
 
 	const LilvPort* port = lilv_plugin_get_port_by_designation (
@@ -508,13 +590,34 @@ int LV2Parser::parse (const char* plugin_uri, const LilvPlugin* p)
 		desc->enable_ctrl_port = lilv_port_get_index (p, port);
 	}
 
+	port = lilv_plugin_get_port_by_designation (p, lv2_InputPort, lv2_freeWheeling);
+	if (port && desc->ports[lilv_port_get_index (p, port)].porttype == CONTROL_IN) {
+		desc->freewheel_ctrl_port = lilv_port_get_index (p, port);
+	}
+
+	/* presets, only the URI and file: the file is parsed when the preset is loaded */
+	LilvNodes* presets = lilv_plugin_get_related (p, pset_Preset);
+	desc->presets = (struct LV2Preset*) calloc (lilv_nodes_size (presets), sizeof (struct LV2Preset));
+	LILV_FOREACH (nodes, i, presets) {
+		const LilvNode* preset = lilv_nodes_get (presets, i);
+		LilvNode* file = lilv_world_get (world, preset, rdfs_seeAlso, NULL);
+		if (desc->presets && file && lilv_node_is_uri (file)) {
+			desc->presets[desc->npresets].uri  = strdup (lilv_node_as_uri (preset));
+			desc->presets[desc->npresets].path = file_strdup (file);
+			++desc->npresets;
+		}
+		lilv_node_free (file);
+	}
+	lilv_nodes_free (presets);
+
 	free (mins);
 	free (maxes);
 	free (defaults);
 	return err;
 }
 
-/* this filters out unsupported plugins */
+/* this filters out unsupported plugins,
+ * the result is cached: bump LV2CACHE_HOST_VERSION when changing it */
 static int verify_support (RtkLv2Description* desc) {
 	// TODO check if inplaceBroken -> ignore
 
@@ -543,11 +646,67 @@ static int verify_support (RtkLv2Description* desc) {
  * public API
  */
 
+uint32_t port_by_symbol (const RtkLv2Description* desc, const char* symbol)
+{
+	if (!desc->symbol_index || !symbol) {
+		return UINT32_MAX;
+	}
+	for (uint32_t h = symbol_hash (symbol) & desc->symbol_mask; ; h = (h + 1) & desc->symbol_mask) {
+		const uint32_t p = desc->symbol_index[h];
+		if (p == UINT32_MAX || !strcmp (desc->ports[p].symbol, symbol)) {
+			return p;
+		}
+	}
+}
+
+const struct LV2Preset* preset_by_uri (const RtkLv2Description* desc, const char* uri)
+{
+	for (uint32_t i = 0; i < desc->npresets; ++i) {
+		if (!strcmp (desc->presets[i].uri, uri)) {
+			return &desc->presets[i];
+		}
+	}
+	return NULL;
+}
+
+LilvState* preset_load (const RtkLv2Description* desc, const char* uri, LV2_URID_Map* map)
+{
+	const struct LV2Preset* preset = preset_by_uri (desc, uri);
+	if (!preset) {
+		return NULL;
+	}
+
+	/* the world was loaded by get_desc_by_uri (), only the preset's file is parsed */
+	vlc_mutex_lock (&world_lock);
+	LilvWorld* w = world_get ();
+	LilvNode* subject = lilv_new_uri (w, preset->uri);
+	LilvState* state = lilv_state_new_from_file (w, map, subject, preset->path);
+	lilv_node_free (subject);
+	vlc_mutex_unlock (&world_lock);
+	return state;
+}
+
+void preset_free (LilvState* state)
+{
+	if (!state) { return; }
+	vlc_mutex_lock (&world_lock);
+	lilv_state_free (state);
+	vlc_mutex_unlock (&world_lock);
+}
+
 RtkLv2Description* get_desc_by_uri (const char* uri)
 {
 	RtkLv2Description* desc = (RtkLv2Description*) calloc (1, sizeof (RtkLv2Description));
-	LV2Parser lp (desc);
-	if (lp.parse (uri)) {
+
+	vlc_mutex_lock (&world_lock);
+	int err;
+	{
+		LV2Parser lp (desc, world_get ());
+		err = lp.parse (uri);
+	}
+	vlc_mutex_unlock (&world_lock);
+
+	if (err) {
 		free_desc (desc);
 		return NULL;
 	}
@@ -574,6 +733,12 @@ void clear_desc (RtkLv2Description* desc)
 		free (desc->ports[i].doc);
 	}
 	free (desc->ports);
+	free (desc->symbol_index);
+	for (uint32_t i = 0; i < desc->npresets; ++i) {
+		free (desc->presets[i].uri);
+		free (desc->presets[i].path);
+	}
+	free (desc->presets);
 	memset (desc, 0, sizeof (RtkLv2Description));
 }
 
@@ -584,49 +749,353 @@ void free_desc (RtkLv2Description* desc)
 	free (desc);
 }
 
-int lv2ls (char*** uris, char*** names)
+static char* xstrdup (const char* s, bool* ok)
+{
+	char* d = s ? strdup (s) : NULL;
+	if (s && !d) {
+		*ok = false;
+	}
+	return d;
+}
+
+/* returns NULL if out of memory */
+RtkLv2Description* dup_desc (const RtkLv2Description* src)
+{
+	RtkLv2Description* desc = (RtkLv2Description*) malloc (sizeof (RtkLv2Description));
+	if (!desc) {
+		return NULL;
+	}
+	/* every pointer is replaced by a copy (or NULL), so that a partial
+	 * copy can be released with free_desc () */
+	bool ok = true;
+	memcpy (desc, src, sizeof (RtkLv2Description));
+	desc->dsp_uri     = xstrdup (src->dsp_uri, &ok);
+	desc->gui_uri     = xstrdup (src->gui_uri, &ok);
+	desc->plugin_name = xstrdup (src->plugin_name, &ok);
+	desc->vendor      = xstrdup (src->vendor, &ok);
+	desc->bundle_path = xstrdup (src->bundle_path, &ok);
+	desc->dsp_path    = xstrdup (src->dsp_path, &ok);
+	desc->gui_path    = xstrdup (src->gui_path, &ok);
+	desc->ports = (struct LV2Port*) malloc (src->nports_total * sizeof (struct LV2Port));
+	if (desc->ports) {
+		memcpy (desc->ports, src->ports, src->nports_total * sizeof (struct LV2Port));
+		for (uint32_t i = 0; i < src->nports_total; ++i) {
+			desc->ports[i].name   = xstrdup (src->ports[i].name, &ok);
+			desc->ports[i].symbol = xstrdup (src->ports[i].symbol, &ok);
+			desc->ports[i].doc    = xstrdup (src->ports[i].doc, &ok);
+		}
+	} else if (src->nports_total > 0) {
+		desc->nports_total = 0;
+		ok = false;
+	}
+	desc->symbol_index = NULL;
+	if (src->symbol_index) {
+		const size_t n = (src->symbol_mask + 1) * sizeof (uint32_t);
+		desc->symbol_index = (uint32_t*) malloc (n);
+		if (desc->symbol_index) {
+			memcpy (desc->symbol_index, src->symbol_index, n);
+		} else {
+			ok = false;
+		}
+	}
+	desc->presets = (struct LV2Preset*) calloc (src->npresets, sizeof (struct LV2Preset));
+	if (desc->presets) {
+		for (uint32_t i = 0; i < src->npresets; ++i) {
+			desc->presets[i].uri  = xstrdup (src->presets[i].uri, &ok);
+			desc->presets[i].path = xstrdup (src->presets[i].path, &ok);
+		}
+	} else if (src->npresets > 0) {
+		desc->npresets = 0;
+		ok = false;
+	}
+	if (!ok) {
+		free_desc (desc);
+		return NULL;
+	}
+	return desc;
+}
+
+static int cmp_cached_uri (const void* a, const void* b)
+{
+	return strcmp ((*(const Lv2CachePlugin**)a)->uri, (*(const Lv2CachePlugin**)b)->uri);
+}
+
+static void ls_append (char*** uris, char*** names, int n_plugins, const char* uri, const char* name)
+{
+	*uris = (char**) realloc (*uris, (n_plugins + 2) * sizeof (char*));
+	*names = (char**) realloc (*names, (n_plugins + 2) * sizeof (char*));
+
+	(*uris)[n_plugins] = strdup (uri);
+	(*uris)[n_plugins + 1] = NULL;
+	(*names)[n_plugins] = strdup (name);
+	(*names)[n_plugins + 1] = NULL;
+}
+
+/* presets are listed as "<plugin name>: <preset label>" */
+static void ls_append_preset (LV2List* presets, const char* plugin_name, const char* uri, const char* label)
+{
+	const size_t len = strlen (plugin_name) + strlen (label) + 3;
+	char* name = (char*) malloc (len);
+	snprintf (name, len, "%s: %s", plugin_name, label);
+	ls_append (&presets->uris, &presets->names, presets->n, uri, name);
+	++presets->n;
+	free (name);
+}
+
+/* add the presets of a supported plugin to the list and the cache-record */
+/* labels of presets that are not in the manifest. The preset's file is
+ * only scanned for rdfs:label, it is not loaded into the world. */
+struct PresetLabels {
+	SerdEnv*     env;
+	const char** uris;
+	char**       labels; // [n], NULL: not found yet
+	unsigned int n;
+};
+
+static SerdStatus scan_base (void* handle, const SerdNode* uri)
+{
+	return serd_env_set_base_uri (((PresetLabels*) handle)->env, uri);
+}
+
+static SerdStatus scan_prefix (void* handle, const SerdNode* name, const SerdNode* uri)
+{
+	return serd_env_set_prefix (((PresetLabels*) handle)->env, name, uri);
+}
+
+/* serd_env_expand_node () of the bundled serd over-reads CURIEs,
+ * compare the prefix and suffix chunks instead */
+static bool scan_node_is (const SerdEnv* env, const SerdNode* node, const char* uri)
+{
+	const size_t len = strlen (uri);
+	if (node->type == SERD_CURIE) {
+		SerdChunk prefix;
+		SerdChunk suffix;
+		return !serd_env_expand (env, node, &prefix, &suffix)
+			&& prefix.len + suffix.len == len
+			&& !memcmp (uri, prefix.buf, prefix.len)
+			&& !memcmp (uri + prefix.len, suffix.buf, suffix.len);
+	}
+	if (node->type != SERD_URI) {
+		return false;
+	}
+	SerdNode abs = serd_env_expand_node (env, node);
+	const bool eq = abs.buf && abs.n_bytes == len && !memcmp (abs.buf, uri, len);
+	serd_node_free (&abs);
+	return eq;
+}
+
+static SerdStatus scan_label (void* handle, SerdStatementFlags, const SerdNode*,
+		const SerdNode* subject, const SerdNode* predicate, const SerdNode* object,
+		const SerdNode*, const SerdNode*)
+{
+	PresetLabels* pl = (PresetLabels*) handle;
+	if (object->type != SERD_LITERAL || !scan_node_is (pl->env, predicate, LILV_NS_RDFS "label")) {
+		return SERD_SUCCESS;
+	}
+	for (unsigned int i = 0; i < pl->n; ++i) {
+		if (!pl->labels[i] && scan_node_is (pl->env, subject, pl->uris[i])) {
+			pl->labels[i] = strdup ((const char*) object->buf);
+		}
+	}
+	return SERD_SUCCESS;
+}
+
+static void scan_preset_file (PresetLabels* pl, const char* file_uri)
+{
+	SerdNode base = serd_node_from_string (SERD_URI, (const uint8_t*) file_uri);
+	pl->env = serd_env_new (&base);
+	SerdReader* reader = serd_reader_new (SERD_TURTLE, pl, NULL, scan_base, scan_prefix, scan_label, NULL);
+	serd_reader_read_file (reader, (const uint8_t*) file_uri);
+	serd_reader_free (reader);
+	serd_env_free (pl->env);
+	pl->env = NULL;
+}
+
+static void ls_presets (LilvWorld* w, const LilvPlugin* p, const char* plugin_name, Lv2CachePlugin* rec, LV2List* list)
+{
+	LilvNode* pset_Preset  = lilv_new_uri (w, LV2_PRESETS__Preset);
+	LilvNode* rdfs_label   = lilv_new_uri (w, LILV_NS_RDFS "label");
+	LilvNode* rdfs_seeAlso = lilv_new_uri (w, LILV_NS_RDFS "seeAlso");
+
+	LilvNodes* presets = lilv_plugin_get_related (p, pset_Preset);
+	const unsigned int n = lilv_nodes_size (presets);
+
+	PresetLabels pl;
+	pl.env    = NULL;
+	pl.uris   = (const char**) calloc (n + 1, sizeof (const char*));
+	pl.labels = (char**) calloc (n + 1, sizeof (char*));
+	pl.n      = 0;
+
+	/* the label is in the manifest, or else usually only in the preset's file */
+	bool missing = false;
+	LILV_FOREACH (nodes, i, presets) {
+		const LilvNode* preset = lilv_nodes_get (presets, i);
+		LilvNode* label = lilv_world_get (w, preset, rdfs_label, NULL);
+		pl.uris[pl.n] = lilv_node_as_uri (preset);
+		if (label) {
+			pl.labels[pl.n] = strdup (lilv_node_as_string (label));
+			lilv_node_free (label);
+		} else {
+			missing = true;
+		}
+		++pl.n;
+	}
+
+	/* scan each file once, it may hold several presets */
+	char** scanned = NULL;
+	unsigned int n_scanned = 0;
+	for (unsigned int k = 0; k < pl.n && missing; ++k) {
+		if (pl.labels[k]) {
+			continue;
+		}
+		LilvNode* preset = lilv_new_uri (w, pl.uris[k]);
+		LilvNodes* files = lilv_world_find_nodes (w, preset, rdfs_seeAlso, NULL);
+		LILV_FOREACH (nodes, f, files) {
+			const LilvNode* file = lilv_nodes_get (files, f);
+			if (pl.labels[k] || !lilv_node_is_uri (file)) {
+				continue;
+			}
+			const char* file_uri = lilv_node_as_uri (file);
+			bool seen = false;
+			for (unsigned int i = 0; i < n_scanned && !seen; ++i) {
+				seen = !strcmp (scanned[i], file_uri);
+			}
+			if (seen) {
+				continue;
+			}
+			scan_preset_file (&pl, file_uri);
+			scanned = (char**) realloc (scanned, (n_scanned + 1) * sizeof (char*));
+			scanned[n_scanned++] = strdup (file_uri);
+		}
+		lilv_nodes_free (files);
+		lilv_node_free (preset);
+	}
+	for (unsigned int i = 0; i < n_scanned; ++i) {
+		free (scanned[i]);
+	}
+	free (scanned);
+
+	for (unsigned int k = 0; k < pl.n; ++k) {
+		const char* txt = pl.labels[k] ? pl.labels[k] : pl.uris[k];
+		if (rec) {
+			cache_add_preset (rec, pl.uris[k], txt);
+		}
+		ls_append_preset (list, plugin_name, pl.uris[k], txt);
+		free (pl.labels[k]);
+	}
+	free (pl.labels);
+	free (pl.uris);
+	lilv_nodes_free (presets);
+
+	lilv_node_free (pset_Preset);
+	lilv_node_free (rdfs_label);
+	lilv_node_free (rdfs_seeAlso);
+}
+
+/* list all plugins from an up-to-date cache, in the same order as lilv */
+static int ls_cached (const Lv2Cache* cache, char*** uris, char*** names, LV2List* presets)
+{
+	const Lv2CachePlugin** list = NULL;
+	int n_list = 0;
+	for (uint32_t i = 0; i < cache->n_bundles; ++i) {
+		for (uint32_t p = 0; p < cache->bundles[i].n_plugins; ++p) {
+			if (!cache->bundles[i].plugins[p].supported) {
+				continue;
+			}
+			list = (const Lv2CachePlugin**) realloc (list, (n_list + 1) * sizeof (Lv2CachePlugin*));
+			list[n_list++] = &cache->bundles[i].plugins[p];
+		}
+	}
+
+	qsort (list, n_list, sizeof (Lv2CachePlugin*), cmp_cached_uri);
+
+	for (int i = 0; i < n_list; ++i) {
+		ls_append (uris, names, i, list[i]->uri, list[i]->name);
+		for (uint32_t r = 0; r < list[i]->n_presets; ++r) {
+			ls_append_preset (presets, list[i]->name, list[i]->presets[r].uri, list[i]->presets[r].label);
+		}
+	}
+	free (list);
+	return n_list;
+}
+
+int lv2ls (char*** uris, char*** names, LV2List* presets, const char* cache_file)
 {
 	int n_plugins = 0;
-	LilvWorld* world = lilv_world_new ();
-	const LilvPlugins* all_plugins;
-	LilvIter* iter;
+	presets->uris = NULL;
+	presets->names = NULL;
+	presets->n = 0;
+
+	Lv2Cache* cache = cache_file ? cache_read (cache_file) : NULL;
+	Lv2Cache* scan = cache_scan ();
+
+	if (cache && scan && cache_uptodate (cache, scan)) {
+		n_plugins = ls_cached (cache, uris, names, presets);
+		cache_free (cache);
+		cache_free (scan);
+		return n_plugins;
+	}
 
-	lilv_world_load_all (world);
-	all_plugins = lilv_world_get_all_plugins (world);
-	iter = lilv_plugins_begin (all_plugins);
+	vlc_mutex_lock (&world_lock);
+	LilvWorld* w = world_get ();
+	const LilvPlugins* all_plugins = lilv_world_get_all_plugins (w);
+	LilvIter* iter = lilv_plugins_begin (all_plugins);
 
 	RtkLv2Description* desc = (RtkLv2Description*) calloc (1, sizeof (RtkLv2Description));
-	LV2Parser lp (desc);
+	LV2Parser* lp = new LV2Parser (desc, w);
 
 	while (!lilv_plugins_is_end (all_plugins, iter)) {
 		const LilvPlugin* p = lilv_plugins_get (all_plugins, iter);
-
-#if 1
-		clear_desc (desc);
-		if (lp.parse (lilv_node_as_string (lilv_plugin_get_uri (p)), p)) {
-			iter = lilv_plugins_next (all_plugins, iter);
-			continue;
-		}
-		if (verify_support (desc)) {
-			iter = lilv_plugins_next (all_plugins, iter);
-			continue;
+		const char* uri = lilv_node_as_string (lilv_plugin_get_uri (p));
+
+		/* re-use the result for unmodified bundles */
+		char* path = lilv_file_uri_parse (lilv_node_as_uri (lilv_plugin_get_bundle_uri (p)), NULL);
+		Lv2CacheBundle* cur = (scan && path) ? cache_find_bundle (scan, path) : NULL;
+		Lv2CacheBundle* old = (cache && path) ? cache_find_bundle (cache, path) : NULL;
+		const Lv2CachePlugin* cached = NULL;
+		if (cur && old && cur->mtime == old->mtime) {
+			cached = cache_find_plugin (old, uri);
 		}
-#endif
+		lilv_free (path);
 
-		*uris = (char**) realloc (*uris, (n_plugins + 2) * sizeof (char*));
-		*names = (char**) realloc (*names, (n_plugins + 2) * sizeof (char*));
+		bool supported;
+		const char* name;
+		LilvNode* name_node = NULL;
 
-		(*uris)[n_plugins] = strdup (lilv_node_as_string (lilv_plugin_get_uri (p)));
-		(*uris)[n_plugins + 1] = NULL;
-		(*names)[n_plugins] = strdup (lilv_node_as_string (lilv_plugin_get_name (p)));
-		(*names)[n_plugins + 1] = NULL;
+		if (cached) {
+			supported = cached->supported;
+			name = cached->name;
+		} else {
+			clear_desc (desc);
+			supported = lp->parse (uri, p) == 0 && verify_support (desc) == 0;
+			name_node = lilv_plugin_get_name (p);
+			name = name_node ? lilv_node_as_string (name_node) : "";
+		}
 
-		//printf ("%s -- %s\n", (*uris)[n_plugins], (*names)[n_plugins]);
-		++n_plugins;
+		Lv2CachePlugin* rec = cur ? cache_add_plugin (cur, uri, name, supported) : NULL;
 
+		if (supported) {
+			ls_append (uris, names, n_plugins, uri, name);
+			//printf ("%s -- %s\n", (*uris)[n_plugins], (*names)[n_plugins]);
+			++n_plugins;
+			/* not taken from the cache-record: presets may be in other bundles */
+			ls_presets (w, p, name, rec, presets);
+		}
+
+		lilv_node_free (name_node);
 		iter = lilv_plugins_next (all_plugins, iter);
 	}
+	delete lp;
 	free_desc (desc);
+	vlc_mutex_unlock (&world_lock);
+
+	if (cache_file && scan) {
+		if (!cache_write (scan, cache_file)) {
+			fprintf (stderr, "LV2: failed to write plugin cache '%s'\n", cache_file);
+		}
+	}
+	cache_free (cache);
+	cache_free (scan);
 	return n_plugins;
 }
 
@@ -19,12 +19,37 @@
 #ifndef _lv2ttl_h_
 #define _lv2ttl_h_
 
+#include "lv2/lv2plug.in/ns/ext/urid/urid.h"
+
 #include "lv2desc.h"
 
+typedef struct LilvStateImpl LilvState;
+
+/* NULL terminated lists */
+typedef struct {
+	char** uris;
+	char** names;
+	int    n;
+} LV2List;
+
 RtkLv2Description* get_desc_by_uri (const char* uri);
 void free_desc (RtkLv2Description* desc);
+RtkLv2Description* dup_desc (const RtkLv2Description* desc);
+
+/* port-index of the port with the given symbol, or UINT32_MAX */
+uint32_t port_by_symbol (const RtkLv2Description* desc, const char* symbol);
+
+/* the preset with the given URI, or NULL */
+const struct LV2Preset* preset_by_uri (const RtkLv2Description* desc, const char* uri);
+
+/* parse a preset of the plugin, URIDs are mapped with `map`.
+ * Only the preset's file is read, the result is free'd with preset_free () */
+LilvState* preset_load (const RtkLv2Description* desc, const char* uri, LV2_URID_Map* map);
+void preset_free (LilvState* state);
 
-int lv2ls (char*** uris, char*** names);
+/* list supported plugins and their presets, `cache_file` (may be NULL)
+ * is used to skip parsing bundles that were not modified since the last call */
+int lv2ls (char*** uris, char*** names, LV2List* presets, const char* cache_file);
 void lv2free (char** uris, char** names);
 
 #endif
@@ -4,6 +4,7 @@
 
 #include <stdlib.h>
 #include <assert.h>
+#include <errno.h>
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
@@ -11,35 +12,82 @@
 #include <vlc_block.h>
 #include <vlc_modules.h>
 #include <vlc_variables.h>
+#include <vlc_configuration.h>
+#include <vlc_fs.h>
 #include <vlc_vout.h>
 #include <vlc_vout_window.h>
 
 #include "lv2desc.h"
 #include "lv2ttl.h"
 #include "lv2plugin.h"
+#include "interleave.h"
+#include "procpool.h"
+#include "statestore.h"
 
-/* save/restore plugin-state in memory */
-#define VOLATILE_STATE 1
+/* save/restore plugin-state to disk, per plugin URI */
+#define PERSISTENT_STATE 1
+
+/* max number of samples per LV2Plugin::process() call */
+static const uint32_t max_block_size = 8192;
+
+/* used if a plugin requires a fixed block-size, but none is configured */
+static const uint32_t default_fixed_block_size = 1024;
+
+/* likewise for offline processing, where latency does not matter */
+static const uint32_t freewheel_block_size = max_block_size;
+
+#ifndef VLC_TICK_INVALID
+# define VLC_TICK_INVALID VLC_TS_INVALID
+# define VLC_TICK_0 VLC_TS_0
+#endif
+
+/* one plugin of the processing chain, replicated to cover all channels */
+struct LV2Stage
+{
+	LV2Plugin**    plugins;   // [0] is the master, with the UI
+	unsigned int   n_plugins;
+	Lv2Vlc::Lv2UriMap* map;   // shared by all instances
+	unsigned int   n_io;      // audio channels per instance
+	vout_window_t* window;    // owned by the GUI thread
+};
 
 struct filter_sys_t
 {
-	RtkLv2Description* desc;
-	LV2Plugin*         plugin;
+	LV2Stage*          stages;
+	unsigned int       n_stages;
 	unsigned int       n_chn;
 	float**            buffers;
 
+	/* channel assignment to plugin-instance inputs */
+	unsigned int*      chanmap;
+	float**            chan_ptr;
+
+	/* fixed block-size FIFO, buffers are the input, delayed the output side */
+	uint32_t           block_size;
+	bool               freewheel;
+	uint32_t           fifo_pos;
+	int64_t            latency;
+	float**            delayed;
+	float**            in_ptr;
+	float**            out_ptr;
+
+	/* optional helper threads to run plugin instances in parallel */
+	Lv2Vlc::Lv2ProcessPool* pool;
+	bool               group_jobs;
+	unsigned int       job_stage;
+	uint32_t           job_samples;
+
 	/* GUI */
 	vlc_thread_t thread;
 	vlc_sem_t    ready;
 	bool         run_ui;
+
+	char*        state_dir;
 };
 
-static void*
-GUIThread (void *p_data)
+static vout_window_t*
+open_ui_window (filter_t* p_filter, LV2Plugin* plugin)
 {
-	filter_t  *p_filter = (filter_t*)p_data;
-	filter_sys_t *p_sys = p_filter->p_sys;
-
 	vout_window_cfg_t cfg;
 
 	cfg.is_fullscreen = false;
@@ -63,6 +111,10 @@ GUIThread (void *p_data)
 	vout_window_t* window = vout_window_New (VLC_OBJECT (p_filter), "$window", &cfg);
 #endif
 
+	if (!window) {
+		return NULL;
+	}
+
 #if defined(_WIN32)
 	void* handle = (void*) window->handle.hwnd;
 #elif defined(__APPLE__)
@@ -71,20 +123,48 @@ GUIThread (void *p_data)
 	void* handle = (void*) (intptr_t)window->handle.xid;
 #endif
 
-	if (!p_sys->plugin->ui ().open (handle)) {
-		vlc_sem_post (&p_sys->ready);
+	if (!plugin->ui ().open (handle)) {
 		vout_window_Delete (window);
 		return NULL;
 	}
+	return window;
+}
+
+static void*
+GUIThread (void *p_data)
+{
+	filter_t  *p_filter = (filter_t*)p_data;
+	filter_sys_t *p_sys = p_filter->p_sys;
+
+	/* one window per plugin, all handled by this thread */
+	bool any = false;
+	for (unsigned int i = 0; i < p_sys->n_stages; ++i) {
+		LV2Stage* st = &p_sys->stages[i];
+		st->window = NULL;
+		if (st->plugins[0]->ui ().has_editor ()) {
+			st->window = open_ui_window (p_filter, st->plugins[0]);
+			any |= st->window != NULL;
+		}
+	}
 
 	vlc_sem_post (&p_sys->ready);
 
+	if (!any) {
+		return NULL;
+	}
+
 	while (p_sys->run_ui) {
 		// TODO: forward size-requests for X11 UI
-		int w, h;
-		p_sys->plugin->ui ().idle ();
-		if (p_sys->plugin->ui ().need_resize (w, h)) {
-			vout_window_Control (window, VOUT_WINDOW_SET_SIZE, w, h);
+		for (unsigned int i = 0; i < p_sys->n_stages; ++i) {
+			LV2Stage* st = &p_sys->stages[i];
+			int w, h;
+			if (!st->window) {
+				continue;
+			}
+			st->plugins[0]->ui ().idle ();
+			if (st->plugins[0]->ui ().need_resize (w, h)) {
+				vout_window_Control (st->window, VOUT_WINDOW_SET_SIZE, w, h);
+			}
 		}
 		// 25fps ~ 40ms
 #if defined(_WIN32)
@@ -94,11 +174,88 @@ GUIThread (void *p_data)
 #endif
 	}
 
-	p_sys->plugin->ui ().close ();
-	vout_window_Delete (window);
+	for (unsigned int i = 0; i < p_sys->n_stages; ++i) {
+		LV2Stage* st = &p_sys->stages[i];
+		if (st->window) {
+			st->plugins[0]->ui ().close ();
+			vout_window_Delete (st->window);
+			st->window = NULL;
+		}
+	}
 	return NULL;
 }
 
+/* one pool job per plugin instance of the current stage */
+static void
+stage_job (void* arg, unsigned int k)
+{
+	filter_sys_t* p_sys = (filter_sys_t*) arg;
+	LV2Stage* st = &p_sys->stages[p_sys->job_stage];
+	st->plugins[k]->process (&p_sys->chan_ptr[k * st->n_io], p_sys->job_samples);
+}
+
+/* all stages use the same channel groups, each group is an independent
+ * branch: run the complete chain for group k */
+static void
+group_job (void* arg, unsigned int k)
+{
+	filter_sys_t* p_sys = (filter_sys_t*) arg;
+	for (unsigned int i = 0; i < p_sys->n_stages; ++i) {
+		LV2Stage* st = &p_sys->stages[i];
+		st->plugins[k]->process (&p_sys->chan_ptr[k * st->n_io], p_sys->job_samples);
+	}
+}
+
+static void
+run_chain_parallel (filter_sys_t* p_sys, uint32_t n_samples)
+{
+	for (unsigned int i = 0; i < p_sys->n_stages; ++i) {
+		LV2Stage* st = &p_sys->stages[i];
+		for (unsigned int k = 1; k < st->n_plugins; ++k) {
+			st->plugins[k]->link_controls (*st->plugins[0]);
+		}
+	}
+
+	p_sys->job_samples = n_samples;
+	if (p_sys->group_jobs) {
+		p_sys->pool->run (group_job, p_sys, p_sys->stages[0].n_plugins);
+		return;
+	}
+
+	/* stages depend on each other, join after every stage */
+	for (unsigned int i = 0; i < p_sys->n_stages; ++i) {
+		LV2Stage* st = &p_sys->stages[i];
+		if (st->n_plugins == 1) {
+			st->plugins[0]->process (p_sys->chan_ptr, n_samples);
+			continue;
+		}
+		p_sys->job_stage = i;
+		p_sys->pool->run (stage_job, p_sys, st->n_plugins);
+	}
+}
+
+/* run all plugins of the chain in order on the same planar buffers */
+static void
+run_chain (filter_sys_t* p_sys, float** bufs, uint32_t n_samples)
+{
+	for (unsigned int c = 0; c < p_sys->n_chn; ++c) {
+		p_sys->chan_ptr[c] = bufs[p_sys->chanmap[c]];
+	}
+	if (p_sys->pool) {
+		run_chain_parallel (p_sys, n_samples);
+		return;
+	}
+	for (unsigned int i = 0; i < p_sys->n_stages; ++i) {
+		LV2Stage* st = &p_sys->stages[i];
+		for (unsigned int k = 0; k < st->n_plugins; ++k) {
+			if (k > 0) {
+				st->plugins[k]->link_controls (*st->plugins[0]);
+			}
+			st->plugins[k]->process (&p_sys->chan_ptr[k * st->n_io], n_samples);
+		}
+	}
+}
+
 static block_t*
 Process (filter_t* p_filter, block_t* block)
 {
@@ -110,39 +267,398 @@ Process (filter_t* p_filter, block_t* block)
 
 	assert (n_chn == p_sys->n_chn);
 
-	// de-interleave and split into at most 8192 sample chunks
-	// TODO: optimize, map channels
-	uint32_t n_proc = 0;
-	for (size_t s = 0; s < n_samples; ++s) {
-		for (size_t c = 0; c < n_chn; ++c) {
-			p_sys->buffers[c][n_proc] = *(ibp++);
-		}
-		if (++n_proc == 8192) {
-			p_sys->plugin->process (p_sys->buffers, n_proc);
-			for (size_t t = 0; t < n_proc; ++t) {
-				for (size_t d = 0; d < n_chn; ++d) {
-					*(obp++) = p_sys->buffers[d][t];
-				}
+	if (p_sys->block_size > 0) {
+		/* fixed block-size: collect a full block, output the previous one */
+		while (n_samples > 0) {
+			uint32_t n_proc = p_sys->block_size - p_sys->fifo_pos;
+			if (n_proc > n_samples) {
+				n_proc = n_samples;
+			}
+			for (size_t c = 0; c < n_chn; ++c) {
+				p_sys->in_ptr[c]  = p_sys->buffers[c] + p_sys->fifo_pos;
+				p_sys->out_ptr[c] = p_sys->delayed[c] + p_sys->fifo_pos;
+			}
+			deinterleave (p_sys->in_ptr, ibp, n_chn, n_proc);
+			interleave (obp, p_sys->out_ptr, n_chn, n_proc);
+			ibp += n_proc * n_chn;
+			obp += n_proc * n_chn;
+			n_samples -= n_proc;
+
+			p_sys->fifo_pos += n_proc;
+			if (p_sys->fifo_pos == p_sys->block_size) {
+				run_chain (p_sys, p_sys->buffers, p_sys->block_size);
+				float** tmp = p_sys->buffers;
+				p_sys->buffers = p_sys->delayed;
+				p_sys->delayed = tmp;
+				p_sys->fifo_pos = 0;
+			}
+		}
+
+		/* the output is one block late, label it accordingly */
+		if (block->i_pts != VLC_TICK_INVALID) {
+			if (block->i_pts > VLC_TICK_0 + p_sys->latency) {
+				block->i_pts -= p_sys->latency;
+			} else {
+				block->i_pts = VLC_TICK_0;
 			}
-			n_proc = 0;
 		}
+		return block;
 	}
-	if (n_proc > 0) {
-		p_sys->plugin->process (p_sys->buffers, n_proc);
-		for (size_t t = 0; t < n_proc; ++t) {
-			for (size_t d = 0; d < n_chn; ++d) {
-				*(obp++) = p_sys->buffers[d][t];
-			}
+
+	if (n_chn == 1) {
+		/* mono: interleaved data is planar, process the block in-place */
+		while (n_samples > 0) {
+			uint32_t n_proc = n_samples > max_block_size ? max_block_size : n_samples;
+			run_chain (p_sys, &ibp, n_proc);
+			ibp += n_proc;
+			n_samples -= n_proc;
 		}
+		return block;
+	}
+
+	// de-interleave and split into chunks of at most max_block_size
+	while (n_samples > 0) {
+		uint32_t n_proc = n_samples > max_block_size ? max_block_size : n_samples;
+		deinterleave (p_sys->buffers, ibp, n_chn, n_proc);
+		run_chain (p_sys, p_sys->buffers, n_proc);
+		interleave (obp, p_sys->buffers, n_chn, n_proc);
+		ibp += n_proc * n_chn;
+		obp += n_proc * n_chn;
+		n_samples -= n_proc;
 	}
 
 	return block;
 }
 
 
-#if VOLATILE_STATE // TODO save to disk, per plugin URI
-static void*   lv2_plugin_state_data = NULL;
-static int32_t lv2_plugin_state_size = 0;
+static void
+Flush (filter_t* p_filter)
+{
+	filter_sys_t *p_sys = p_filter->p_sys;
+	for (unsigned int c = 0; c < p_sys->n_chn; ++c) {
+		memset (p_sys->buffers[c], 0, p_sys->block_size * sizeof (float));
+		memset (p_sys->delayed[c], 0, p_sys->block_size * sizeof (float));
+	}
+	p_sys->fifo_pos = 0;
+}
+
+static void
+free_buffers (float** bufs, unsigned int n_chn)
+{
+	if (!bufs) {
+		return;
+	}
+	for (unsigned int c = 0; c < n_chn; ++c) {
+		free (bufs[c]);
+	}
+	free (bufs);
+}
+
+/* returns NULL if out of memory */
+static float**
+alloc_buffers (unsigned int n_chn, uint32_t n_samples)
+{
+	float** bufs = (float**) calloc (n_chn, sizeof (float*));
+	if (!bufs) {
+		return NULL;
+	}
+	for (unsigned int c = 0; c < n_chn; ++c) {
+		bufs[c] = (float*) calloc (n_samples, sizeof (float));
+		if (!bufs[c]) {
+			free_buffers (bufs, c);
+			return NULL;
+		}
+	}
+	return bufs;
+}
+
+static void
+free_stages (filter_sys_t* p_sys)
+{
+	for (unsigned int i = 0; i < p_sys->n_stages; ++i) {
+		for (unsigned int k = 0; k < p_sys->stages[i].n_plugins; ++k) {
+			delete p_sys->stages[i].plugins[k]; // free()s desc
+		}
+		free (p_sys->stages[i].plugins);
+		delete p_sys->stages[i].map;
+	}
+	free (p_sys->stages);
+	p_sys->stages = NULL;
+	p_sys->n_stages = 0;
+}
+
+/* find the next URI of a space or semicolon separated list,
+ * returns its length, 0 at the end of the list */
+static size_t
+skip_uri (const char** list, const char** uri)
+{
+	const char* sep = " \t;";
+	*uri = *list + strspn (*list, sep);
+	size_t len = strcspn (*uri, sep);
+	*list = *uri + len;
+	return len;
+}
+
+/* return a copy of the next URI of the list, or NULL at the end
+ * of the list or if out of memory */
+static char*
+next_uri (const char** list)
+{
+	const char* u;
+	size_t len = skip_uri (list, &u);
+	if (len == 0) {
+		return NULL;
+	}
+	char* uri = (char*) malloc (len + 1);
+	if (!uri) {
+		return NULL;
+	}
+	memcpy (uri, u, len);
+	uri[len] = 0;
+	return uri;
+}
+
+/* instantiate all plugins of the URI list, in order */
+static int
+create_stages (filter_t* p_filter, const char* uri_list)
+{
+	filter_sys_t *p_sys = p_filter->p_sys;
+
+	p_sys->stages = NULL;
+	p_sys->n_stages = 0;
+
+	unsigned int n_uris = 0;
+	const char* u = uri_list;
+	const char* item;
+	while (skip_uri (&u, &item) > 0) {
+		++n_uris;
+	}
+
+	if (n_uris == 0) {
+		return VLC_EGENERIC;
+	}
+
+	RtkLv2Description** descs = (RtkLv2Description**) calloc (n_uris, sizeof (RtkLv2Description*));
+	p_sys->stages = (LV2Stage*) calloc (n_uris, sizeof (LV2Stage));
+	if (!descs || !p_sys->stages) {
+		free (descs);
+		free (p_sys->stages);
+		return VLC_ENOMEM;
+	}
+
+	/* parse all first, the block-size has to be known before instantiating */
+	bool ok = true;
+	int err = VLC_EGENERIC;
+	u = uri_list;
+	for (unsigned int i = 0; i < n_uris && ok; ++i) {
+		char* uri = next_uri (&u);
+		if (!uri) {
+			err = VLC_ENOMEM;
+			ok = false;
+			break;
+		}
+		descs[i] = get_desc_by_uri (uri);
+		free (uri);
+
+		if (!descs[i]) {
+			ok = false;
+		} else if (descs[i]->nports_audio_in != descs[i]->nports_audio_out
+				|| descs[i]->nports_audio_in == 0
+				|| (p_sys->n_chn % descs[i]->nports_audio_in) != 0) {
+			fprintf (stderr, "Skipping LV2 plugin '%s' -- mismatched channel count\n", descs[i]->dsp_uri);
+			ok = false;
+		} else if (descs[i]->requires_fixed_block && p_sys->block_size == 0) {
+			p_sys->block_size = p_sys->freewheel ? freewheel_block_size : default_fixed_block_size;
+		}
+	}
+
+	const float rate = p_filter->fmt_in.audio.i_rate;
+	const bool fixed_block = p_sys->block_size > 0;
+	const int32_t block_size = fixed_block ? p_sys->block_size : max_block_size;
+
+	/* replicate instances, e.g. 3 stereo plugins for 5.1 */
+	for (unsigned int i = 0; i < n_uris && ok; ++i) {
+		LV2Stage* st = &p_sys->stages[i];
+		st->n_io = descs[i]->nports_audio_in;
+		st->plugins = (LV2Plugin**) calloc (p_sys->n_chn / st->n_io, sizeof (LV2Plugin*));
+		if (!st->plugins) {
+			err = VLC_ENOMEM;
+			ok = false;
+			break;
+		}
+		/* one URI map per stage, so that a preset or state parsed for
+		 * one instance is valid for all of them */
+		st->map = new Lv2Vlc::Lv2UriMap ();
+		++p_sys->n_stages;
+
+		for (unsigned int k = 0; k < p_sys->n_chn / st->n_io && ok; ++k) {
+			RtkLv2Description* desc = (k == 0) ? descs[i] : dup_desc (descs[i]);
+			if (!desc) {
+				err = VLC_ENOMEM;
+				ok = false;
+				break;
+			}
+			try {
+				st->plugins[k] = new LV2Plugin (desc, *st->map, rate, block_size, fixed_block);
+				++st->n_plugins;
+			} catch (...) {
+				free_desc (desc);
+				ok = false;
+			}
+			if (k == 0) {
+				descs[i] = NULL; // owned by the plugin
+			}
+		}
+	}
+
+	for (unsigned int i = 0; i < n_uris; ++i) {
+		free_desc (descs[i]);
+	}
+	free (descs);
+
+	if (!ok) {
+		free_stages (p_sys);
+		return err;
+	}
+	return VLC_SUCCESS;
+}
+
+/* parse the "chanmap" option: a comma separated permutation of the
+ * input channels, assigned in order to the inputs of all replicated
+ * plugin instances. e.g. "0,4,1,5,2,3". Returns NULL if out of memory. */
+static unsigned int*
+parse_chanmap (filter_t* p_filter, unsigned int n_chn)
+{
+	unsigned int* map = (unsigned int*) malloc (n_chn * sizeof (unsigned int));
+	if (!map) {
+		return NULL;
+	}
+	for (unsigned int c = 0; c < n_chn; ++c) {
+		map[c] = c;
+	}
+
+	char* str = var_CreateGetStringCommand (p_filter, "chanmap");
+	if (!str || !*str) {
+		free (str);
+		return map;
+	}
+
+	bool* used = (bool*) calloc (n_chn, sizeof (bool));
+	if (!used) {
+		free (str);
+		free (map);
+		return NULL;
+	}
+	bool ok = true;
+	unsigned int n = 0;
+	for (const char* s = str; *s && ok; ) {
+		char* end;
+		long c = strtol (s, &end, 10);
+		if (end == s || c < 0 || c >= (long)n_chn || n >= n_chn || used[c]) {
+			ok = false;
+			break;
+		}
+		used[c] = true;
+		map[n++] = c;
+		s = end + strspn (end, " ,");
+	}
+
+	if (!ok || n != n_chn) {
+		fprintf (stderr, "LV2: invalid channel map '%s' for %u channels, ignored\n", str, n_chn);
+		for (unsigned int c = 0; c < n_chn; ++c) {
+			map[c] = c;
+		}
+	}
+	free (used);
+	free (str);
+	return map;
+}
+
+/* apply the "preset" option: a list of preset URIs, each is loaded into
+ * all instances of the plugin(s) it belongs to */
+static void
+apply_presets (filter_t* p_filter)
+{
+	filter_sys_t *p_sys = p_filter->p_sys;
+	char* preset_list = var_CreateGetStringCommand (p_filter, "preset");
+	if (!preset_list) {
+		return;
+	}
+	const char* u = preset_list;
+	for (char* uri; (uri = next_uri (&u)); free (uri)) {
+		bool found = false;
+		for (unsigned int i = 0; i < p_sys->n_stages; ++i) {
+			LV2Stage* st = &p_sys->stages[i];
+			if (!st->plugins[0]->has_preset (uri)) {
+				continue;
+			}
+			found = true;
+			LV2Plugin::load_preset (st->plugins, st->n_plugins, uri);
+		}
+		if (!found) {
+			fprintf (stderr, "LV2: preset '%s' is not for any plugin of the chain, ignored\n", uri);
+		}
+	}
+	free (preset_list);
+}
+
+/* true if the stream output only writes to files, e.g.
+ * "#transcode{..}:std{access=file,mux=..,dst=..}". Processing is then not
+ * paced by a clock. Live streaming and local display keep realtime pace,
+ * anything that is not recognized counts as such. */
+static bool
+sout_to_file (const char* sout)
+{
+	static const char* const paced[] = {
+		"display", "http", "udp", "rtp", "rtsp", "smem", "chromecast", "bridge", NULL
+	};
+	if (!sout || !*sout) {
+		return false;
+	}
+	for (int i = 0; paced[i]; ++i) {
+		if (strstr (sout, paced[i])) {
+			return false;
+		}
+	}
+	return strstr (sout, "access=file") || strstr (sout, "file{") || !strncmp (sout, "file/", 5);
+}
+
+#if PERSISTENT_STATE
+/* plugin state, e.g. ~/.local/share/vlc/lv2-state/ */
+static char*
+plugin_state_dir ()
+{
+	char* dir = config_GetUserDir (VLC_USERDATA_DIR);
+	if (!dir) {
+		return NULL;
+	}
+	char* path = NULL;
+	if ((vlc_mkdir (dir, 0700) == 0 || errno == EEXIST)
+			&& asprintf (&path, "%s" DIR_SEP "lv2-state", dir) >= 0) {
+		if (vlc_mkdir (path, 0700) != 0 && errno != EEXIST) {
+			free (path);
+			path = NULL;
+		}
+	} else {
+		path = NULL;
+	}
+	free (dir);
+	return path;
+}
+
+/* number of earlier stages that use the same plugin */
+static unsigned int
+stage_instance (filter_sys_t* p_sys, unsigned int stage)
+{
+	const char* uri = p_sys->stages[stage].plugins[0]->uri ();
+	unsigned int n = 0;
+	for (unsigned int i = 0; i < stage; ++i) {
+		if (!strcmp (p_sys->stages[i].plugins[0]->uri (), uri)) {
+			++n;
+		}
+	}
+	return n;
+}
 #endif
 
 static int
@@ -160,61 +676,164 @@ Open (vlc_object_t* obj)
 	p_filter->fmt_out.audio = p_filter->fmt_in.audio;
 	p_sys->n_chn = p_filter->fmt_in.audio.i_channels;
 
-	// TODO "Host wrapper" for multiple plugins.
-	// also handle channel mapping (replicate plugin instance as needed ...)
-
-	p_sys->desc = get_desc_by_uri (var_CreateGetStringCommand (p_filter, "uri"));
-
-	if (!p_sys->desc) {
+	char* uri_list = var_CreateGetStringCommand (p_filter, "uri");
+	if (!uri_list) {
 		free (p_sys);
 		return VLC_EGENERIC;
 	}
 
-	if (p_sys->desc->nports_audio_in != p_sys->desc->nports_audio_out || p_sys->desc->nports_audio_in != p_sys->n_chn) {
-		fprintf (stderr, "Skipping LV2 plugin -- mismatched channel count\n");
-		free_desc (p_sys->desc);
+	p_sys->block_size = var_CreateGetIntegerCommand (p_filter, "blocksize");
+	if (p_sys->block_size > max_block_size || (p_sys->block_size & (p_sys->block_size - 1))) {
+		fprintf (stderr, "LV2: invalid block-size %u, using variable block-size\n", p_sys->block_size);
+		p_sys->block_size = 0;
+	}
+
+	/* freewheel: processing is not paced by the audio output (transcode, convert to file) */
+	switch (var_CreateGetIntegerCommand (p_filter, "freewheel")) {
+		case 1:
+			p_sys->freewheel = true;
+			break;
+		case 2:
+			p_sys->freewheel = false;
+			break;
+		default:
+			{
+				char* sout = var_InheritString (p_filter, "sout");
+				p_sys->freewheel = sout_to_file (sout);
+				free (sout);
+			}
+			break;
+	}
+
+	int rv = create_stages (p_filter, uri_list);
+	free (uri_list);
+
+	if (rv != VLC_SUCCESS) {
 		free (p_sys);
-		return VLC_EGENERIC;
+		return rv;
+	}
+
+	if (p_sys->freewheel) {
+		msg_Dbg (p_filter, "freewheel mode");
+		for (unsigned int i = 0; i < p_sys->n_stages; ++i) {
+			for (unsigned int k = 0; k < p_sys->stages[i].n_plugins; ++k) {
+				p_sys->stages[i].plugins[k]->set_freewheeling (true);
+			}
+		}
 	}
 
-	try {
-		p_sys->plugin = new LV2Plugin (p_sys->desc, p_filter->fmt_in.audio.i_rate);
-	} catch (...) {
-		free_desc (p_sys->desc);
+	p_sys->chanmap  = parse_chanmap (p_filter, p_sys->n_chn);
+	p_sys->chan_ptr = (float**) calloc (p_sys->n_chn, sizeof (float*));
+
+	/* allocate non-interleaved buffers */
+	p_sys->fifo_pos = 0;
+	p_sys->latency  = 0;
+	p_sys->delayed  = NULL;
+	p_sys->in_ptr   = NULL;
+	p_sys->out_ptr  = NULL;
+
+	bool oom;
+	if (p_sys->block_size > 0) {
+		p_sys->buffers = alloc_buffers (p_sys->n_chn, p_sys->block_size);
+		p_sys->delayed = alloc_buffers (p_sys->n_chn, p_sys->block_size);
+		p_sys->in_ptr  = (float**) calloc (p_sys->n_chn, sizeof (float*));
+		p_sys->out_ptr = (float**) calloc (p_sys->n_chn, sizeof (float*));
+		p_sys->latency = CLOCK_FREQ * (int64_t)p_sys->block_size / p_filter->fmt_in.audio.i_rate;
+		oom = !p_sys->buffers || !p_sys->delayed || !p_sys->in_ptr || !p_sys->out_ptr;
+	} else {
+		p_sys->buffers = alloc_buffers (p_sys->n_chn, max_block_size);
+		oom = !p_sys->buffers;
+	}
+
+	if (oom || !p_sys->chanmap || !p_sys->chan_ptr) {
+		free_stages (p_sys);
+		free (p_sys->chanmap);
+		free (p_sys->chan_ptr);
+		free_buffers (p_sys->buffers, p_sys->n_chn);
+		free_buffers (p_sys->delayed, p_sys->n_chn);
+		free (p_sys->in_ptr);
+		free (p_sys->out_ptr);
 		free (p_sys);
-		return VLC_EGENERIC;
+		return VLC_ENOMEM;
 	}
 
-	/* Create GUI thread */
+	/* parallel processing is only useful with replicated instances */
+	p_sys->pool = NULL;
+	p_sys->group_jobs = true;
+	p_sys->job_stage = 0;
+	p_sys->job_samples = 0;
+	unsigned int max_jobs = 0;
+	for (unsigned int i = 0; i < p_sys->n_stages; ++i) {
+		if (p_sys->stages[i].n_plugins > max_jobs) {
+			max_jobs = p_sys->stages[i].n_plugins;
+		}
+		if (p_sys->stages[i].n_io != p_sys->stages[0].n_io) {
+			p_sys->group_jobs = false;
+		}
+	}
+	int64_t n_threads = var_CreateGetIntegerCommand (p_filter, "threads");
+	if (n_threads > 0 && max_jobs > 1) {
+		if (n_threads > max_jobs - 1) {
+			n_threads = max_jobs - 1;
+		}
+		p_sys->pool = new Lv2Vlc::Lv2ProcessPool (n_threads);
+		if (p_sys->pool->n_threads () == 0) {
+			delete p_sys->pool;
+			p_sys->pool = NULL;
+		}
+	}
+
+	/* Create GUI thread, one for all plugins of the chain */
 	vlc_sem_init (&p_sys->ready, 0);
-	if (p_sys->plugin->ui ().has_editor ()) {
-		p_sys->run_ui = true;
+	p_sys->run_ui = false;
+	for (unsigned int i = 0; i < p_sys->n_stages; ++i) {
+		if (p_sys->stages[i].plugins[0]->ui ().has_editor ()) {
+			p_sys->run_ui = true;
+		}
+	}
+
+	if (p_sys->run_ui) {
 		if (vlc_clone (&p_sys->thread, GUIThread, p_filter, VLC_THREAD_PRIORITY_VIDEO)) {
-			delete p_sys->plugin; // free()s p_sys->desc
+			delete p_sys->pool;
+			free_stages (p_sys);
+			free (p_sys->chanmap);
+			free (p_sys->chan_ptr);
+			free_buffers (p_sys->buffers, p_sys->n_chn);
+			free_buffers (p_sys->delayed, p_sys->n_chn);
+			free (p_sys->in_ptr);
+			free (p_sys->out_ptr);
 			vlc_sem_destroy (&p_sys->ready);
 			free (p_sys);
 			return VLC_EGENERIC;
 		}
 		/* Wait for the ui thread. */
 		vlc_sem_wait (&p_sys->ready);
-	} else {
-		p_sys->run_ui = false;
 	}
 
-	/* allocate non-interleaved buffers */
-
-	p_sys->buffers = (float**) malloc (sizeof (float*) * p_sys->n_chn);
-	for (unsigned int c = 0; c < p_sys->n_chn; ++c) {
-		p_sys->buffers[c] = (float*) malloc (8192 * sizeof (float));
-		// TODO catch OOM.
-	}
+	interleave_init ();
 
 	p_filter->pf_audio_filter = Process;
-#if VOLATILE_STATE
-	if (lv2_plugin_state_data) {
-		p_sys->plugin->load_state (lv2_plugin_state_data, lv2_plugin_state_size);
+	if (p_sys->block_size > 0) {
+		p_filter->pf_flush = Flush;
+	}
+	p_sys->state_dir = NULL;
+#if PERSISTENT_STATE
+	/* restore the state that each plugin had when it was last closed */
+	p_sys->state_dir = plugin_state_dir ();
+	for (unsigned int i = 0; i < p_sys->n_stages && p_sys->state_dir; ++i) {
+		LV2Stage* st = &p_sys->stages[i];
+		Lv2StateFile* sf = state_store_load (p_sys->state_dir, st->plugins[0]->uri (), stage_instance (p_sys, i));
+		if (!sf) {
+			continue;
+		}
+		for (unsigned int k = 0; k < st->n_plugins; ++k) {
+			st->plugins[k]->load_state (sf->data, sf->size);
+		}
+		state_store_release (sf);
 	}
 #endif
+	/* an explicitly selected preset takes precedence over the saved state */
+	apply_presets (p_filter);
 	return VLC_SUCCESS;
 }
 
@@ -224,9 +843,18 @@ Close (vlc_object_t* obj)
 	filter_t* p_filter = (filter_t*)obj;
 	filter_sys_t *p_sys = p_filter->p_sys;
 
-#if VOLATILE_STATE
-	lv2_plugin_state_size =  p_sys->plugin->save_state (&lv2_plugin_state_data);
+#if PERSISTENT_STATE
+	for (unsigned int i = 0; i < p_sys->n_stages && p_sys->state_dir; ++i) {
+		LV2Plugin* plugin = p_sys->stages[i].plugins[0];
+		void* data = NULL;
+		int32_t size = plugin->save_state (&data);
+		if (data && !state_store_save (p_sys->state_dir, plugin->uri (), stage_instance (p_sys, i), data, size)) {
+			fprintf (stderr, "LV2: failed to save state of '%s'\n", plugin->uri ());
+		}
+		free (data);
+	}
 #endif
+	free (p_sys->state_dir);
 	/* Terminate GUI thread. */
 	if (p_sys->run_ui) {
 		p_sys->run_ui = false;
@@ -234,24 +862,85 @@ Close (vlc_object_t* obj)
 	}
 	vlc_sem_destroy (&p_sys->ready);
 
-	delete p_sys->plugin; // free()s p_sys->desc
+	delete p_sys->pool;
+	free_stages (p_sys);
 
-	for (unsigned int c = 0; c < p_sys->n_chn; ++c) {
-		free (p_sys->buffers[c]);
-	}
-	free (p_sys->buffers);
+	free (p_sys->chanmap);
+	free (p_sys->chan_ptr);
+	free_buffers (p_sys->buffers, p_sys->n_chn);
+	free_buffers (p_sys->delayed, p_sys->n_chn);
+	free (p_sys->in_ptr);
+	free (p_sys->out_ptr);
 	free (p_sys);
 }
 
 
+static const int block_sizes[] = {
+	0, 64, 128, 256, 512, 1024, 2048, 4096, 8192
+};
+static const char* const block_size_names[] = {
+	"Variable", "64", "128", "256", "512", "1024", "2048", "4096", "8192"
+};
+
+static const int freewheel_modes[] = { 0, 1, 2 };
+static const char* const freewheel_mode_names[] = {
+	"Auto (when converting to a file)", "Always", "Never"
+};
+
+/* plugin list cache, e.g. ~/.cache/vlc/lv2-plugins.cache */
+static char*
+plugin_cache_file ()
+{
+	char* dir = config_GetUserDir (VLC_CACHE_DIR);
+	if (!dir) {
+		return NULL;
+	}
+	char* file = NULL;
+	if (vlc_mkdir (dir, 0700) == 0 || errno == EEXIST) {
+		if (asprintf (&file, "%s" DIR_SEP "lv2-plugins.cache", dir) < 0) {
+			file = NULL;
+		}
+	}
+	free (dir);
+	return file;
+}
+
 // TODO: free on module unload
 static char** uris = NULL;
 static char** names = NULL;
 static int n_plugs = 0;
+static LV2List presets;
+
+/* the first entry of the preset list selects none */
+static void
+prepend_no_preset (LV2List* list)
+{
+	char** u = (char**) realloc (list->uris, (list->n + 2) * sizeof (char*));
+	if (u) {
+		list->uris = u;
+	}
+	char** n = (char**) realloc (list->names, (list->n + 2) * sizeof (char*));
+	if (n) {
+		list->names = n;
+	}
+	if (!u || !n) {
+		return;
+	}
+	memmove (&list->uris[1], &list->uris[0], list->n * sizeof (char*));
+	memmove (&list->names[1], &list->names[0], list->n * sizeof (char*));
+	list->uris[0] = strdup ("");
+	list->names[0] = strdup ("None");
+	++list->n;
+	list->uris[list->n] = NULL;
+	list->names[list->n] = NULL;
+}
 
 vlc_module_begin ()
 	if (!uris) {
-		n_plugs = lv2ls (&uris, &names);
+		char* cache_file = plugin_cache_file ();
+		n_plugs = lv2ls (&uris, &names, &presets, cache_file);
+		free (cache_file);
+		prepend_no_preset (&presets);
 	}
 	set_shortname ("LV2")
 	set_description ("Load LV2 Audio Plugins")
@@ -260,6 +949,19 @@ vlc_module_begin ()
 	set_category (CAT_AUDIO)
 	set_subcategory (SUBCAT_AUDIO_AFILTER)
 
-	add_string ("uri", "", "Plugin", "Select Plugin", false)
+	add_string ("uri", "", "Plugin", "Select Plugin, several plugin URIs separated by space or semicolon are run in sequence", false)
 	vlc_config_set (VLC_CONFIG_LIST, n_plugs, uris, names);
+
+	add_string ("preset", "", "Preset", "Load a preset of the plugin when it is started, several preset URIs (for different plugins of the chain) can be separated by space or semicolon", false)
+	vlc_config_set (VLC_CONFIG_LIST, presets.n, presets.uris, presets.names);
+
+	add_string ("chanmap", "", "Channel map", "Comma separated list of input channels, in the order they are assigned to plugin instances. If a plugin has fewer channels than the stream, it is replicated. e.g. \"0,4,1,5,2,3\" pairs channels 0+4, 1+5, 2+3 for three stereo instances. Default: in stream order", false)
+
+	add_integer ("blocksize", 0, "Block size", "Run the plugin with a fixed number of samples per cycle, this adds one block of latency (0: variable, as delivered by VLC)", false)
+	change_integer_list (block_sizes, block_size_names)
+
+	add_integer ("threads", 0, "Process threads", "Number of additional threads to run replicated plugin instances in parallel (0: process everything on the audio thread)", false)
+
+	add_integer ("freewheel", 0, "Freewheel", "Process offline, faster than realtime: plugin background work is done synchronously and plugins are informed via lv2:freeWheeling. Auto enables it when VLC's stream output (--sout) only writes to files, e.g. convert/save", false)
+	change_integer_list (freewheel_modes, freewheel_mode_names)
 vlc_module_end ()
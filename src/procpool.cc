@@ -0,0 +1,134 @@
+/*
+ *  Copyright (C) 2016 Robin Gareus <robin@gareus.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sched.h>
+#endif
+
+#include "procpool.h"
+
+using namespace Lv2Vlc;
+
+Lv2ProcessPool::Lv2ProcessPool (unsigned int n_threads)
+	: _threads (0)
+	, _n_threads (0)
+	, _job (0)
+	, _arg (0)
+	, _n_jobs (0)
+	, _next (0)
+	, _done (0)
+	, _run (true)
+{
+	_threads = (ThreadCtx*) calloc (n_threads, sizeof (ThreadCtx));
+	if (!_threads) {
+		return;
+	}
+	for (unsigned int i = 0; i < n_threads; ++i) {
+		ThreadCtx* t = &_threads[_n_threads];
+		t->pool = this;
+		t->id   = _n_threads;
+		vlc_sem_init (&t->wake, 0);
+		if (vlc_clone (&t->thread, thread_func, t, VLC_THREAD_PRIORITY_AUDIO)) {
+			fprintf (stderr, "LV2Host: failed to start process thread %u\n", i);
+			vlc_sem_destroy (&t->wake);
+			break;
+		}
+		++_n_threads;
+	}
+}
+
+Lv2ProcessPool::~Lv2ProcessPool ()
+{
+	_run = false;
+	for (unsigned int i = 0; i < _n_threads; ++i) {
+		vlc_sem_post (&_threads[i].wake);
+	}
+	for (unsigned int i = 0; i < _n_threads; ++i) {
+		vlc_join (_threads[i].thread, NULL);
+		vlc_sem_destroy (&_threads[i].wake);
+	}
+	free (_threads);
+}
+
+void Lv2ProcessPool::process_jobs ()
+{
+	uint32_t i;
+	while ((i = __atomic_fetch_add (&_next, 1, __ATOMIC_RELAXED)) < _n_jobs) {
+		_job (_arg, i);
+	}
+}
+
+void Lv2ProcessPool::run (Job job, void* arg, unsigned int n_jobs)
+{
+	/* Each helper has its own semaphore and is woken exactly once per cycle.
+	 * The cycle only ends when every woken helper has checked out, so
+	 * a late helper can never pick up jobs of the following cycle. */
+	unsigned int n_wake = n_jobs > 0 ? n_jobs - 1 : 0;
+	if (n_wake > _n_threads) {
+		n_wake = _n_threads;
+	}
+
+	_job    = job;
+	_arg    = arg;
+	_n_jobs = n_jobs;
+	__atomic_store_n (&_next, 0, __ATOMIC_RELAXED);
+	__atomic_store_n (&_done, 0, __ATOMIC_RELAXED);
+
+	/* sem_post implies a release barrier for the above */
+	for (unsigned int i = 0; i < n_wake; ++i) {
+		vlc_sem_post (&_threads[i].wake);
+	}
+
+	process_jobs ();
+
+	unsigned int spin = 0;
+	while (__atomic_load_n (&_done, __ATOMIC_ACQUIRE) != n_wake) {
+		if (++spin < 1024) {
+			continue;
+		}
+#ifdef _WIN32
+		Sleep (0);
+#else
+		sched_yield ();
+#endif
+	}
+}
+
+void* Lv2ProcessPool::thread_func (void* data)
+{
+	ThreadCtx* t = (ThreadCtx*) data;
+	t->pool->thread_main (t->id);
+	return NULL;
+}
+
+void Lv2ProcessPool::thread_main (unsigned int id)
+{
+	while (1) {
+		vlc_sem_wait (&_threads[id].wake);
+		if (!_run) {
+			break;
+		}
+		process_jobs ();
+		__atomic_fetch_add (&_done, 1, __ATOMIC_RELEASE);
+	}
+}
@@ -0,0 +1,68 @@
+/*
+ *  Copyright (C) 2016 Robin Gareus <robin@gareus.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _procpool_h_
+#define _procpool_h_
+
+#include <vlc_common.h>
+#include <vlc_threads.h>
+
+namespace Lv2Vlc {
+
+/* fork/join pool to run independent plugin instances of one cycle in parallel.
+ * The calling (audio) thread takes part in processing, and waits for
+ * the helper threads on an atomic counter, no locks are involved. */
+class Lv2ProcessPool
+{
+	public:
+		typedef void (*Job) (void* arg, unsigned int index);
+
+		Lv2ProcessPool (unsigned int n_threads);
+		~Lv2ProcessPool ();
+
+		unsigned int n_threads () const { return _n_threads; }
+
+		/* call job (arg, 0 .. n_jobs - 1), returns when all are complete */
+		void run (Job job, void* arg, unsigned int n_jobs);
+
+	private:
+		static void* thread_func (void*);
+		void thread_main (unsigned int id);
+		void process_jobs ();
+
+		struct ThreadCtx {
+			Lv2ProcessPool* pool;
+			unsigned int    id;
+			vlc_thread_t    thread;
+			vlc_sem_t       wake;
+		};
+
+		ThreadCtx*    _threads;
+		unsigned int  _n_threads;
+
+		Job           _job;
+		void*         _arg;
+		uint32_t      _n_jobs;
+
+		uint32_t      _next; // atomic, next job index to take
+		uint32_t      _done; // atomic, number of helpers that finished the cycle
+		volatile bool _run;
+};
+
+} /* namespace */
+#endif
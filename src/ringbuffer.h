@@ -22,62 +22,63 @@
 #include <cstring> // memcpy
 #include <stdint.h>
 
-#ifdef __clang__
-# if __has_feature(cxx_atomic)
-#  define CLANG_CXX11_ATOMICS 1
-# endif
-#endif
-
-#ifdef CLANG_CXX11_ATOMICS
-#include <atomic>
-
-#define _atomic_int_get(P)    (P)
-#define _atomic_int_set(P, V) (P) = (V)
-#define adef std::atomic<uint32_t>
-#define avar std::atomic<uint32_t>
+#if defined __ATOMIC_ACQUIRE
 
-#elif defined __ATOMIC_SEQ_CST && !defined __clang__
-
-#define _atomic_int_get(P)    __atomic_load_4 (&(P), __ATOMIC_SEQ_CST)
-#define _atomic_int_set(P, V) __atomic_store_4 (&(P), (V), __ATOMIC_SEQ_CST)
-
-#define adef uint32_t
-#define avar uint32_t
+#define _atomic_int_get(P)    __atomic_load_n (&(P), __ATOMIC_ACQUIRE)
+#define _atomic_int_set(P, V) __atomic_store_n (&(P), (V), __ATOMIC_RELEASE)
 
 #elif defined __GNUC__
 
-#define _atomic_int_set(P,V) __sync_lock_test_and_set (&(P), (V))
-#define _atomic_int_get(P)   __sync_add_and_fetch (&(P), 0)
-#define adef volatile uint32_t
-#define avar uint32_t
+#define _atomic_int_get(P)    __sync_add_and_fetch (&(P), 0)
+#define _atomic_int_set(P, V) do { __sync_synchronize (); (P) = (V); } while (0)
 
 #else
 
 #warning non-atomic ringbuffer
 
-#define _atomic_int_set(P,V) P = (V)
-#define _atomic_int_get(P) P
-#define adef size_t
-#define avar size_t
+#define _atomic_int_get(P)    (P)
+#define _atomic_int_set(P, V) (P) = (V)
 
 #endif
 
+#ifndef RINGBUFFER_CACHELINE
+# define RINGBUFFER_CACHELINE 64
+#endif
+
 namespace Lv2VlcUtil {
 
+/* single-producer, single-consumer lock-free ringbuffer.
+ *
+ * The size is rounded up to a power of two and all of it is usable.
+ * read and write positions are free-running 32bit counters (the buffer
+ * offset is the position masked by size - 1), each written only by its
+ * own side, and kept on separate cache-lines. Each side also caches
+ * the other side's position and only re-reads it when the cached value
+ * suggests there is not enough data/space.
+ *
+ * write() and write_space() must only be called by the producer,
+ * read() and read_space() only by the consumer.
+ */
 template<class T> class RingBuffer
 {
 	public:
 		RingBuffer (size_t s) {
-			size = s;
+			size = 1;
+			while (size < s) {
+				size <<= 1;
+			}
+			mask = size - 1;
 			buf = new T[size];
 			reset ();
 		}
 
-		virtual ~RingBuffer () {
+		~RingBuffer () {
 			delete [] buf;
 		}
 
+		/* not thread-safe, neither side may be active */
 		void reset () {
+			cached_read_ptr = cached_write_ptr = 0;
 			_atomic_int_set (write_ptr, 0);
 			_atomic_int_set (read_ptr, 0);
 		}
@@ -86,117 +87,245 @@ template<class T> class RingBuffer
 		size_t write (const T *src, size_t cnt);
 
 		size_t write_space () {
-			size_t w, r;
-
-			w = _atomic_int_get (write_ptr);
-			r = _atomic_int_get (read_ptr);
-
-			if (w > r) {
-				return ((r - w + size) % size) - 1;
-			} else if (w < r) {
-				return (r - w) - 1;
-			} else {
-				return size - 1;
-			}
+			cached_read_ptr = _atomic_int_get (read_ptr);
+			return size - (uint32_t)(write_ptr - cached_read_ptr);
 		}
 
 		size_t read_space () {
-			avar w;
-			avar r;
-
-			w = _atomic_int_get (write_ptr);
-			r = _atomic_int_get (read_ptr);
-
-			if (w > r) {
-				return w - r;
-			} else {
-				return (w - r + size) % size;
-			}
+			cached_write_ptr = _atomic_int_get (write_ptr);
+			return (uint32_t)(cached_write_ptr - read_ptr);
 		}
 
-	protected:
-		T *buf;
-		size_t size;
-		adef write_ptr;
-		adef read_ptr;
+	private:
+		RingBuffer (const RingBuffer&);
+		RingBuffer& operator= (const RingBuffer&);
+
+		/* shared, read-only after construction */
+		T*       buf;
+		uint32_t size;
+		uint32_t mask;
+		char     _pad0[RINGBUFFER_CACHELINE];
+
+		/* producer */
+		uint32_t write_ptr;
+		uint32_t cached_read_ptr;
+		char     _pad1[RINGBUFFER_CACHELINE - 2 * sizeof (uint32_t)];
+
+		/* consumer */
+		uint32_t read_ptr;
+		uint32_t cached_write_ptr;
+		char     _pad2[RINGBUFFER_CACHELINE - 2 * sizeof (uint32_t)];
 };
 
 template<class T> size_t RingBuffer<T>::read (T *dest, size_t cnt)
 {
-	size_t free_cnt;
-	size_t cnt2;
-	size_t to_read;
-	size_t n1, n2;
-	size_t my_read_ptr;
-
-	my_read_ptr = _atomic_int_get (read_ptr);
+	const uint32_t r = read_ptr; // only modified by this thread
 
-	if ((free_cnt = read_space ()) == 0) {
+	uint32_t avail = cached_write_ptr - r;
+	if (avail < cnt) {
+		avail = read_space ();
+	}
+	if (avail == 0) {
 		return 0;
 	}
 
-	to_read = cnt > free_cnt ? free_cnt : cnt;
+	const uint32_t to_read = cnt > avail ? avail : cnt;
+	const uint32_t offset  = r & mask;
+	const uint32_t n1 = to_read > size - offset ? size - offset : to_read;
+
+	memcpy (dest, &buf[offset], n1 * sizeof (T));
+	if (to_read > n1) {
+		memcpy (dest + n1, buf, (to_read - n1) * sizeof (T));
+	}
 
-	cnt2 = my_read_ptr + to_read;
+	_atomic_int_set (read_ptr, r + to_read);
+	return to_read;
+}
 
-	if (cnt2 > size) {
-		n1 = size - my_read_ptr;
-		n2 = cnt2 % size;
-	} else {
-		n1 = to_read;
-		n2 = 0;
+template<class T> size_t RingBuffer<T>::write (const T *src, size_t cnt)
+{
+	const uint32_t w = write_ptr; // only modified by this thread
+
+	uint32_t avail = size - (uint32_t)(w - cached_read_ptr);
+	if (avail < cnt) {
+		avail = write_space ();
+	}
+	if (avail == 0) {
+		return 0;
 	}
 
-	memcpy (dest, &buf[my_read_ptr], n1 * sizeof (T));
-	my_read_ptr = (my_read_ptr + n1) % size;
+	const uint32_t to_write = cnt > avail ? avail : cnt;
+	const uint32_t offset   = w & mask;
+	const uint32_t n1 = to_write > size - offset ? size - offset : to_write;
 
-	if (n2) {
-		memcpy (dest+n1, buf, n2 * sizeof (T));
-		my_read_ptr = n2;
+	memcpy (&buf[offset], src, n1 * sizeof (T));
+	if (to_write > n1) {
+		memcpy (buf, src + n1, (to_write - n1) * sizeof (T));
 	}
 
-	_atomic_int_set (read_ptr, my_read_ptr);
-	return to_read;
+	_atomic_int_set (write_ptr, w + to_write);
+	return to_write;
 }
 
-template<class T> size_t RingBuffer<T>::write (const T *src, size_t cnt)
+/* single-producer, single-consumer ringbuffer for variable-size messages.
+ *
+ * Every message is stored contiguously, preceded by an 8 byte header and
+ * padded to a multiple of 8 bytes, so an LV2_Atom can be built in, or
+ * handed out directly from the buffer. A message that does not fit before
+ * the end of the buffer is placed at the start, and the tail is marked as
+ * padding. The header also carries an application defined message type.
+ *
+ * reserve()/commit() must only be called by the producer,
+ * peek()/consume() only by the consumer.
+ */
+class MessageRing
 {
-	size_t free_cnt;
-	size_t cnt2;
-	size_t to_write;
-	size_t n1, n2;
-	size_t my_write_ptr;
+	public:
+		MessageRing (size_t s) {
+			size = 64;
+			while (size < s) {
+				size <<= 1;
+			}
+			mask = size - 1;
+			buf = new uint64_t[size / sizeof (uint64_t)];
+			reset ();
+		}
 
-	my_write_ptr = _atomic_int_get (write_ptr);
+		~MessageRing () {
+			delete [] buf;
+		}
 
-	if ((free_cnt = write_space ()) == 0) {
-		return 0;
-	}
+		/* not thread-safe, neither side may be active */
+		void reset () {
+			pending = peeked = 0;
+			cached_read_ptr = cached_write_ptr = 0;
+			_atomic_int_set (write_ptr, 0);
+			_atomic_int_set (read_ptr, 0);
+		}
 
-	to_write = cnt > free_cnt ? free_cnt : cnt;
+		/* largest message that is guaranteed to fit into an empty ring.
+		 * A message is never split: if it does not fit before the end of
+		 * the buffer, the tail is skipped, which can cost up to half of
+		 * the ring, depending on the current write offset. */
+		uint32_t max_message () const { return size / 2 - sizeof (Header); }
 
-	cnt2 = my_write_ptr + to_write;
+		/* most messages of the given size that can be queued at once */
+		uint32_t max_messages (uint32_t len) const { return size / padded (len); }
 
-	if (cnt2 > size) {
-		n1 = size - my_write_ptr;
-		n2 = cnt2 % size;
-	} else {
-		n1 = to_write;
-		n2 = 0;
-	}
+		/* ring size for which max_message () >= len */
+		static size_t size_for (uint32_t len) { return 2 * padded (len); }
 
-	memcpy (&buf[my_write_ptr], src, n1 * sizeof (T));
-	my_write_ptr = (my_write_ptr + n1) % size;
+		/* return space for a message of the given size, or NULL if
+		 * there is no room. The message is queued by commit(). */
+		void* reserve (uint32_t len, uint32_t type = 0) {
+			if (len > max_message ()) {
+				return NULL;
+			}
+			const uint32_t w    = write_ptr;
+			const uint32_t need = padded (len);
+			uint32_t offset = w & mask;
+			uint32_t skip   = need > size - offset ? size - offset : 0;
+
+			if (size - (uint32_t)(w - cached_read_ptr) < skip + need) {
+				cached_read_ptr = _atomic_int_get (read_ptr);
+				if (size - (uint32_t)(w - cached_read_ptr) < skip + need) {
+					return NULL;
+				}
+			}
+			if (skip) {
+				header (offset)->size = WRAP;
+				offset = 0;
+			}
+			header (offset)->size = len;
+			header (offset)->type = type;
+			pending = skip + need;
+			return header (offset) + 1;
+		}
 
-	if (n2) {
-		memcpy (buf, src+n1, n2 * sizeof (T));
-		my_write_ptr = n2;
-	}
+		void commit () {
+			_atomic_int_set (write_ptr, write_ptr + pending);
+			pending = 0;
+		}
 
-	_atomic_int_set (write_ptr, my_write_ptr);
-	return to_write;
-}
+		bool write (const void* data, uint32_t len) {
+			void* dst = reserve (len);
+			if (!dst) {
+				return false;
+			}
+			memcpy (dst, data, len);
+			commit ();
+			return true;
+		}
 
-} /* namespace */
+		/* return the next message and its size, or NULL if the ring is
+		 * empty. The message remains valid until consume(). */
+		const void* peek (uint32_t* len, uint32_t* type = NULL) {
+			uint32_t r = read_ptr;
+			while (1) {
+				if (cached_write_ptr == r) {
+					cached_write_ptr = _atomic_int_get (write_ptr);
+					if (cached_write_ptr == r) {
+						return NULL;
+					}
+				}
+				const uint32_t offset = r & mask;
+				const Header* h = header (offset);
+				if (h->size == WRAP) {
+					r += size - offset;
+					_atomic_int_set (read_ptr, r);
+					continue;
+				}
+				*len   = h->size;
+				peeked = padded (h->size);
+				if (type) {
+					*type = h->type;
+				}
+				return h + 1;
+			}
+		}
+
+		void consume () {
+			_atomic_int_set (read_ptr, read_ptr + peeked);
+			peeked = 0;
+		}
+
+	private:
+		MessageRing (const MessageRing&);
+		MessageRing& operator= (const MessageRing&);
 
+		struct Header {
+			uint32_t size;
+			uint32_t type;
+		};
+
+		static const uint32_t WRAP = 0xffffffff;
+
+		static uint32_t padded (uint32_t len) {
+			return sizeof (Header) + ((len + 7) & ~7U);
+		}
+
+		Header* header (uint32_t offset) const {
+			return (Header*)((uint8_t*)buf + offset);
+		}
+
+		/* shared, read-only after construction */
+		uint64_t* buf;
+		uint32_t  size;
+		uint32_t  mask;
+		char      _pad0[RINGBUFFER_CACHELINE];
+
+		/* producer */
+		uint32_t  write_ptr;
+		uint32_t  cached_read_ptr;
+		uint32_t  pending;
+		char      _pad1[RINGBUFFER_CACHELINE - 3 * sizeof (uint32_t)];
+
+		/* consumer */
+		uint32_t  read_ptr;
+		uint32_t  cached_write_ptr;
+		uint32_t  peeked;
+		char      _pad2[RINGBUFFER_CACHELINE - 3 * sizeof (uint32_t)];
+};
+
+} /* namespace */
 #endif
@@ -0,0 +1,322 @@
+/*
+ *  Copyright (C) 2016 Robin Gareus <robin@gareus.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* producer/consumer throughput of Lv2VlcUtil::RingBuffer, compared to
+ * the implementation it replaced (modulo indexing, seq-cst atomics,
+ * both positions on one cache-line, no cached positions).
+ *
+ *   make ringbuffer_bench
+ *   ./ringbuffer_bench [producer-cpu consumer-cpu]
+ *
+ * The threads are pinned to the given CPUs (Linux only, default 0 and
+ * 1, or both 0 on a single CPU machine). They need to be on different
+ * cores to see the effect of the cache-line separation.
+ */
+
+#ifdef __linux__
+# ifndef _GNU_SOURCE
+#  define _GNU_SOURCE
+# endif
+#endif
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ringbuffer.h"
+
+#define RING_SIZE 8192
+#define CHUNK     64
+#define TOTAL     (1U << 28)
+
+/* the previous Lv2VlcUtil::RingBuffer (before the SPSC rewrite),
+ * verbatim apart from the class and macro names */
+
+#ifdef __clang__
+# if __has_feature(cxx_atomic)
+#  define BASELINE_CLANG_CXX11_ATOMICS 1
+# endif
+#endif
+
+#ifdef BASELINE_CLANG_CXX11_ATOMICS
+#include <atomic>
+
+#define _baseline_int_get(P)    (P)
+#define _baseline_int_set(P, V) (P) = (V)
+#define baseline_adef std::atomic<uint32_t>
+#define baseline_avar std::atomic<uint32_t>
+
+#elif defined __ATOMIC_SEQ_CST && !defined __clang__
+
+#define _baseline_int_get(P)    __atomic_load_4 (&(P), __ATOMIC_SEQ_CST)
+#define _baseline_int_set(P, V) __atomic_store_4 (&(P), (V), __ATOMIC_SEQ_CST)
+
+#define baseline_adef uint32_t
+#define baseline_avar uint32_t
+
+#elif defined __GNUC__
+
+#define _baseline_int_set(P,V) __sync_lock_test_and_set (&(P), (V))
+#define _baseline_int_get(P)   __sync_add_and_fetch (&(P), 0)
+#define baseline_adef volatile uint32_t
+#define baseline_avar uint32_t
+
+#else
+
+#warning non-atomic ringbuffer
+
+#define _baseline_int_set(P,V) P = (V)
+#define _baseline_int_get(P) P
+#define baseline_adef size_t
+#define baseline_avar size_t
+
+#endif
+
+template<class T> class BaselineRingBuffer
+{
+	public:
+		BaselineRingBuffer (size_t s) {
+			size = s;
+			buf = new T[size];
+			reset ();
+		}
+
+		virtual ~BaselineRingBuffer () {
+			delete [] buf;
+		}
+
+		void reset () {
+			_baseline_int_set (write_ptr, 0);
+			_baseline_int_set (read_ptr, 0);
+		}
+
+		size_t read  (T *dest, size_t cnt);
+		size_t write (const T *src, size_t cnt);
+
+		size_t write_space () {
+			size_t w, r;
+
+			w = _baseline_int_get (write_ptr);
+			r = _baseline_int_get (read_ptr);
+
+			if (w > r) {
+				return ((r - w + size) % size) - 1;
+			} else if (w < r) {
+				return (r - w) - 1;
+			} else {
+				return size - 1;
+			}
+		}
+
+		size_t read_space () {
+			baseline_avar w;
+			baseline_avar r;
+
+			w = _baseline_int_get (write_ptr);
+			r = _baseline_int_get (read_ptr);
+
+			if (w > r) {
+				return w - r;
+			} else {
+				return (w - r + size) % size;
+			}
+		}
+
+	protected:
+		T *buf;
+		size_t size;
+		baseline_adef write_ptr;
+		baseline_adef read_ptr;
+};
+
+template<class T> size_t BaselineRingBuffer<T>::read (T *dest, size_t cnt)
+{
+	size_t free_cnt;
+	size_t cnt2;
+	size_t to_read;
+	size_t n1, n2;
+	size_t my_read_ptr;
+
+	my_read_ptr = _baseline_int_get (read_ptr);
+
+	if ((free_cnt = read_space ()) == 0) {
+		return 0;
+	}
+
+	to_read = cnt > free_cnt ? free_cnt : cnt;
+
+	cnt2 = my_read_ptr + to_read;
+
+	if (cnt2 > size) {
+		n1 = size - my_read_ptr;
+		n2 = cnt2 % size;
+	} else {
+		n1 = to_read;
+		n2 = 0;
+	}
+
+	memcpy (dest, &buf[my_read_ptr], n1 * sizeof (T));
+	my_read_ptr = (my_read_ptr + n1) % size;
+
+	if (n2) {
+		memcpy (dest+n1, buf, n2 * sizeof (T));
+		my_read_ptr = n2;
+	}
+
+	_baseline_int_set (read_ptr, my_read_ptr);
+	return to_read;
+}
+
+template<class T> size_t BaselineRingBuffer<T>::write (const T *src, size_t cnt)
+{
+	size_t free_cnt;
+	size_t cnt2;
+	size_t to_write;
+	size_t n1, n2;
+	size_t my_write_ptr;
+
+	my_write_ptr = _baseline_int_get (write_ptr);
+
+	if ((free_cnt = write_space ()) == 0) {
+		return 0;
+	}
+
+	to_write = cnt > free_cnt ? free_cnt : cnt;
+
+	cnt2 = my_write_ptr + to_write;
+
+	if (cnt2 > size) {
+		n1 = size - my_write_ptr;
+		n2 = cnt2 % size;
+	} else {
+		n1 = to_write;
+		n2 = 0;
+	}
+
+	memcpy (&buf[my_write_ptr], src, n1 * sizeof (T));
+	my_write_ptr = (my_write_ptr + n1) % size;
+
+	if (n2) {
+		memcpy (buf, src+n1, n2 * sizeof (T));
+		my_write_ptr = n2;
+	}
+
+	_baseline_int_set (write_ptr, my_write_ptr);
+	return to_write;
+}
+
+static int cpus[2] = { 0, 1 };
+
+static void pin (int cpu)
+{
+#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO (&set);
+	CPU_SET (cpu, &set);
+	if (pthread_setaffinity_np (pthread_self (), sizeof (set), &set)) {
+		fprintf (stderr, "cannot pin thread to CPU %d\n", cpu);
+	}
+#else
+	(void) cpu;
+#endif
+}
+
+static double now ()
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+template<class R>
+static void* producer (void* arg)
+{
+	R* rb = (R*) arg;
+	char chunk[CHUNK];
+	unsigned char c = 0;
+	pin (cpus[0]);
+	for (uint32_t n = 0; n < TOTAL; ) {
+		for (size_t i = 0; i < CHUNK; ++i) {
+			chunk[i] = c + i;
+		}
+		size_t done = 0;
+		while (done < CHUNK) {
+			size_t w = rb->write (chunk + done, CHUNK - done);
+			if (w == 0) {
+				sched_yield ();
+			}
+			done += w;
+		}
+		c += CHUNK;
+		n += CHUNK;
+	}
+	return NULL;
+}
+
+template<class R>
+static void run (const char* name)
+{
+	R rb (RING_SIZE);
+	pthread_t thread;
+	char chunk[CHUNK];
+	unsigned char c = 0;
+	unsigned int errors = 0;
+
+	const double t0 = now ();
+	pthread_create (&thread, NULL, producer<R>, &rb);
+	pin (cpus[1]);
+	for (uint32_t n = 0; n < TOTAL; ) {
+		size_t r = rb.read (chunk, CHUNK);
+		if (r == 0) {
+			sched_yield ();
+			continue;
+		}
+		for (size_t i = 0; i < r; ++i) {
+			if ((unsigned char) chunk[i] != c++) {
+				++errors;
+			}
+		}
+		n += r;
+	}
+	pthread_join (thread, NULL);
+	const double dt = now () - t0;
+
+	printf ("%-16s %8.1f MB/s%s\n", name, TOTAL / dt / 1e6, errors ? "  DATA ERROR" : "");
+}
+
+int main (int argc, char** argv)
+{
+	if (argc == 3) {
+		cpus[0] = atoi (argv[1]);
+		cpus[1] = atoi (argv[2]);
+	}
+	if (sysconf (_SC_NPROCESSORS_ONLN) < 2) {
+		printf ("note: single CPU, producer and consumer share a core\n");
+		if (argc != 3) {
+			cpus[1] = 0;
+		}
+	}
+	printf ("producer on CPU %d, consumer on CPU %d, %d byte chunks\n", cpus[0], cpus[1], CHUNK);
+	run<BaselineRingBuffer<char> > ("baseline");
+	run<Lv2VlcUtil::RingBuffer<char> > ("RingBuffer");
+	return 0;
+}
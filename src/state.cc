@@ -28,155 +28,458 @@
 # include <arpa/inet.h>
 #endif
 
+#include "lilv/lilv.h"
+
 #include "lv2plugin.h"
+#include "lv2ttl.h"
+
+/* ****************************************************************************
+ * state container, all integers are in network byte order.
+ *
+ *   0  "LV2S"
+ *   4  version
+ *   8  total size in bytes, including this header
+ *  12  Adler-32 checksum of bytes 16 .. size
+ *  16  number of sections, followed by the section table:
+ *      { uint32 id, uint32 offset, uint32 size } for each section
+ *
+ * Sections:
+ *   PROP: count, { key-URI, type-URI, flags, size, value } plugin properties
+ *   PORT: count, { value, symbol } control input ports, floats as IEEE754 bits
+ * Strings are stored as length followed by the characters, no terminator.
+ * Readers skip sections that they do not know.
+ *
+ * Property values of the fixed-size atom scalars (Int, Long, Float,
+ * Double, Bool) are stored in network byte order, too. All other values
+ * are stored as the plugin provides them, they can only be shared
+ * across machines if the plugin marks them LV2_STATE_IS_PORTABLE.
+ * Version 1 stored all values in host byte order, it is still read.
+ */
 
-static void free_lv2state (LV2Plugin::LV2State* state)
+#define STATE_MAGIC    "LV2S"
+#define STATE_VERSION  2
+#define STATE_HEADER   16
+#define SECTION_PROP   0x50524f50 // 'PROP'
+#define SECTION_PORT   0x504f5254 // 'PORT'
+
+static uint32_t adler32 (const uint8_t* d, size_t len)
 {
-	for (uint32_t i = 0; i < state->n_props; ++i) {
-		free (state->props[i].value);
-	}
-	for (uint32_t i = 0; i < state->n_values; ++i) {
-		free (state->values[i].symbol);
+	uint32_t a = 1, b = 0;
+	while (len > 0) {
+		/* largest n such that b does not overflow */
+		size_t n = len < 5552 ? len : 5552;
+		len -= n;
+		while (n--) {
+			a += *d++;
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
 	}
-	free (state);
+	return (b << 16) | a;
 }
 
-static size_t serialize_string (uint8_t *d, const char* str)
+/* size of a property value that is stored in network byte order,
+ * 0 if it is stored as is */
+static size_t scalar_size (const char* type_uri, size_t size)
 {
-	uint32_t len = strlen (str);
-	uint32_t v = htonl (len);
-	memcpy (d, &v, sizeof (uint32_t));
-	d += sizeof (uint32_t);
-	memcpy (d, str, len);
-	return len + sizeof (uint32_t);
+	static const struct { const char* uri; size_t size; } scalars[] = {
+		{ LV2_ATOM__Int,    sizeof (int32_t) },
+		{ LV2_ATOM__Bool,   sizeof (int32_t) },
+		{ LV2_ATOM__Float,  sizeof (float) },
+		{ LV2_ATOM__Long,   sizeof (int64_t) },
+		{ LV2_ATOM__Double, sizeof (double) },
+	};
+	for (size_t i = 0; i < sizeof (scalars) / sizeof (scalars[0]); ++i) {
+		if (scalars[i].size == size && !strcmp (scalars[i].uri, type_uri)) {
+			return size;
+		}
+	}
+	return 0;
 }
 
-static size_t unserialize_string (uint8_t *d, char** str)
+/* convert between host and network byte order, the conversion is symmetric */
+static void swap_scalar (uint8_t* dst, const void* src, size_t size)
 {
-	uint32_t v;
-	memcpy (&v, d, sizeof (uint32_t));
-	d += sizeof (uint32_t);
-	uint32_t len = ntohl (v);
-	*str = (char*) malloc (len + 1);
-	memcpy (*str, d, len);
-	(*str)[len] = 0;
-	return len + sizeof (uint32_t);
+	const uint8_t* s = (const uint8_t*) src;
+	if (htonl (1) == 1) {
+		memcpy (dst, s, size);
+		return;
+	}
+	for (size_t i = 0; i < size; ++i) {
+		dst[i] = s[size - 1 - i];
+	}
 }
 
-// TODO use .ttl instead (save LV2 presets) ??
-size_t LV2Plugin::serialize_state (LV2State* state, void** data)
+/* ****************************************************************************
+ * serialize
+ *
+ * The state is written in a single pass into a growable buffer, which
+ * is handed to the caller as is. Plugin properties are appended by
+ * store_callback () as the plugin saves them.
+ */
+
+class StateWriter
 {
-	size_t size = 2 * sizeof (uint32_t);
+	public:
+		StateWriter (size_t initial)
+			: _buf ((uint8_t*) malloc (initial))
+			, _size (_buf ? initial : 0)
+			, _used (0)
+			, _failed (!_buf)
+		{}
+
+		~StateWriter () { free (_buf); }
+
+		bool failed () const { return _failed; }
+		size_t used () const { return _used; }
+		const uint8_t* data () const { return _buf; }
+
+		/* pass ownership of the buffer to the caller */
+		void* release () {
+			void* d = _buf;
+			_buf = NULL;
+			return d;
+		}
 
-	for (uint32_t i = 0; i < state->n_props; ++i) {
-		LV2PortProperty *p = &state->props[i];
-		size += sizeof (uint32_t) * 4 + state->props[i].size;
-		size += strlen (_map.id_to_uri (p->key));
-		size += strlen (_map.id_to_uri (p->type));
-	}
-	for (uint32_t i = 0; i < state->n_values; ++i) {
-		size += sizeof (float);
-		size += sizeof (uint32_t);
-		size += strlen (state->values[i].symbol);
-	}
+		uint8_t* append (size_t n) {
+			if (_used + n > _size && !grow (_used + n)) {
+				return NULL;
+			}
+			uint8_t* d = _buf + _used;
+			_used += n;
+			return d;
+		}
 
-	uint8_t* d = (uint8_t*) malloc (size);
-	uint32_t v;
-	*data = (void*) d;
+		void put (const void* data, size_t n) {
+			uint8_t* d = append (n);
+			if (d) {
+				memcpy (d, data, n);
+			}
+		}
 
-	v = htonl (state->n_props);  memcpy (d, &v, sizeof (uint32_t)); d += sizeof (uint32_t);
-	v = htonl (state->n_values); memcpy (d, &v, sizeof (uint32_t)); d += sizeof (uint32_t);
+		void put_uint (uint32_t v) {
+			v = htonl (v);
+			put (&v, sizeof (uint32_t));
+		}
 
-	for (uint32_t i = 0; i < state->n_props; ++i) {
-		LV2PortProperty *p = &state->props[i];
-		d += serialize_string (d, _map.id_to_uri (p->key));
-		d += serialize_string (d, _map.id_to_uri (p->type));
-		v = htonl (p->flags); memcpy (d, &v, sizeof (uint32_t)); d += sizeof (uint32_t);
-		v = htonl (p->size);  memcpy (d, &v, sizeof (uint32_t)); d += sizeof (uint32_t);
-		memcpy (d, p->value, p->size); d += p->size;
+		void put_float (float f) {
+			uint32_t v;
+			memcpy (&v, &f, sizeof (uint32_t));
+			put_uint (v);
+		}
+
+		void put_string (const char* str) {
+			uint32_t len = strlen (str);
+			put_uint (len);
+			put (str, len);
+		}
+
+		void set_uint (size_t offset, uint32_t v) {
+			if (!_failed) {
+				v = htonl (v);
+				memcpy (_buf + offset, &v, sizeof (uint32_t));
+			}
+		}
+
+	private:
+		bool grow (size_t need) {
+			if (_failed) {
+				return false;
+			}
+			size_t size = _size * 2;
+			if (size < need) {
+				size = need;
+			}
+			uint8_t* b = (uint8_t*) realloc (_buf, size);
+			if (!b) {
+				_failed = true;
+				return false;
+			}
+			_buf = b;
+			_size = size;
+			return true;
+		}
+
+		uint8_t* _buf;
+		size_t   _size;
+		size_t   _used;
+		bool     _failed;
+};
+
+struct StoreHandle {
+	StateWriter*       writer;
+	Lv2Vlc::Lv2UriMap* map;
+	uint32_t           n_props;
+};
+
+static LV2_State_Status store_callback (
+		LV2_State_Handle handle,
+		uint32_t         key,
+		const void*      value,
+		size_t           size,
+		uint32_t         type,
+		uint32_t         flags)
+{
+	StoreHandle* const sh = (StoreHandle*)handle;
+	const char* key_uri  = sh->map->id_to_uri (key);
+	const char* type_uri = sh->map->id_to_uri (type);
+	if (!key_uri || !type_uri || size != (uint32_t)size) {
+		return LV2_STATE_ERR_UNKNOWN;
 	}
-	for (uint32_t i = 0; i < state->n_values; ++i) {
-		LV2PortValue *p = &state->values[i];
-		memcpy (d, &p->value, sizeof (float)); d += sizeof (float); // portable?
-		d += serialize_string (d, p->symbol);
+
+	/* values are copied, so non-POD data is fine, too */
+	StateWriter* w = sh->writer;
+	w->put_string (key_uri);
+	w->put_string (type_uri);
+	w->put_uint (flags);
+	w->put_uint (size);
+	if (scalar_size (type_uri, size)) {
+		uint8_t* d = w->append (size);
+		if (d) {
+			swap_scalar (d, value, size);
+		}
+	} else {
+		w->put (value, size);
 	}
-	return size;
+	++sh->n_props;
+
+	return w->failed () ? LV2_STATE_ERR_UNKNOWN : LV2_STATE_SUCCESS;
 }
 
-// TODO use .ttl instead (read presets) ??
-LV2Plugin::LV2State* LV2Plugin::unserialize_state (void* data, size_t s)
+/* ****************************************************************************
+ * unserialize
+ *
+ * The parsed state is a single allocation: LV2State, followed by the
+ * props and values arrays, followed by property values (8 byte aligned)
+ * and NUL terminated strings.
+ */
+
+/* bounds-checked reads, once a read fails all following reads fail, too */
+class StateReader
 {
-	if (s < 2 * sizeof (uint32_t)) {
-		return NULL;
-	}
+	public:
+		StateReader (const uint8_t* d, size_t s)
+			: _d (d)
+			, _end (d + s)
+			, _ok (true)
+		{}
+
+		bool ok () const { return _ok; }
+
+		const uint8_t* get (size_t n) {
+			if (!_ok || (size_t)(_end - _d) < n) {
+				_ok = false;
+				return NULL;
+			}
+			const uint8_t* d = _d;
+			_d += n;
+			return d;
+		}
+
+		uint32_t get_uint () {
+			uint32_t v = 0;
+			const uint8_t* d = get (sizeof (uint32_t));
+			if (d) {
+				memcpy (&v, d, sizeof (uint32_t));
+			}
+			return ntohl (v);
+		}
 
-#define GETUINT(T)                     \
-  {                                    \
-    uint32_t v;                        \
-    memcpy (&v, d, sizeof (uint32_t)); \
-    T = ntohl (v);                     \
-    d += sizeof (uint32_t);            \
-  }
+		float get_float () {
+			uint32_t v = get_uint ();
+			float f;
+			memcpy (&f, &v, sizeof (float));
+			return f;
+		}
 
-	uint8_t* d = (uint8_t*) data;
-	LV2State* const state = (LV2State*)calloc (1, sizeof (LV2State));
-	GETUINT (state->n_props);
-	GETUINT (state->n_values);
+		const char* get_string (uint32_t* len) {
+			*len = get_uint ();
+			return (const char*) get (*len);
+		}
 
-	state->props  = (LV2PortProperty*) calloc (state->n_props, sizeof (LV2PortProperty));
-	state->values = (LV2PortValue*) calloc (state->n_values, sizeof (LV2PortValue));
+	private:
+		const uint8_t* _d;
+		const uint8_t* _end;
+		bool           _ok;
+};
 
-	for (uint32_t i = 0; i < state->n_props; ++i) {
-		LV2PortProperty *p = &state->props[i];
-		char *k = NULL;
-		d += unserialize_string (d, &k);
-		p->key = _map.uri_to_id (k);
-		free (k);
+static size_t align8 (size_t s)
+{
+	return (s + 7) & ~(size_t)7;
+}
 
-		k = NULL;
-		d += unserialize_string (d, &k);
-		p->type = _map.uri_to_id (k);
-		free (k);
+static uint32_t urid_hash (uint32_t key)
+{
+	uint32_t h = key * 0x9e3779b1;
+	return h ^ (h >> 16);
+}
 
-		GETUINT (p->flags);
-		GETUINT (p->size);
-		p->value = malloc (p->size);
-		memcpy (p->value, d, p->size); d += p->size;
+static char* copy_string (StateReader& r, uint8_t** arena)
+{
+	uint32_t len;
+	const char* s = r.get_string (&len);
+	char* str = (char*) *arena;
+	if (s) {
+		memcpy (str, s, len);
+	} else {
+		len = 0;
 	}
-	for (uint32_t i = 0; i < state->n_values; ++i) {
-		LV2PortValue *p = &state->values[i];
-		memcpy (&p->value, d, sizeof (float)); d += sizeof (float); // portable?
-		d += unserialize_string (d, &p->symbol);
+	str[len] = '\0';
+	*arena += len + 1;
+	return str;
+}
+
+/* check the header and the section table, return the sections */
+static bool parse_container (const uint8_t* data, size_t s, uint32_t* version, StateReader* props, StateReader* ports)
+{
+	StateReader r (data, s);
+	const uint8_t* magic = r.get (4);
+	*version = r.get_uint ();
+	const uint32_t size    = r.get_uint ();
+	const uint32_t csum    = r.get_uint ();
+	const uint32_t n_sect  = r.get_uint ();
+
+	if (!r.ok () || memcmp (magic, STATE_MAGIC, 4)) {
+		fprintf (stderr, "LV2Host: not a state container\n");
+		return false;
 	}
-	return state;
+	if (*version < 1 || *version > STATE_VERSION) {
+		fprintf (stderr, "LV2Host: unsupported state version %u\n", *version);
+		return false;
+	}
+	if (size > s || size < STATE_HEADER + sizeof (uint32_t)) {
+		fprintf (stderr, "LV2Host: state is truncated\n");
+		return false;
+	}
+	if (n_sect > (size - STATE_HEADER - sizeof (uint32_t)) / (3 * sizeof (uint32_t))) {
+		return false;
+	}
+	if (adler32 (data + STATE_HEADER, size - STATE_HEADER) != csum) {
+		fprintf (stderr, "LV2Host: state checksum mismatch\n");
+		return false;
+	}
+
+	for (uint32_t i = 0; i < n_sect; ++i) {
+		const uint32_t id     = r.get_uint ();
+		const uint32_t offset = r.get_uint ();
+		const uint32_t length = r.get_uint ();
+		if (offset > size || length > size - offset) {
+			return false;
+		}
+		if (id == SECTION_PROP) {
+			*props = StateReader (data + offset, length);
+		} else if (id == SECTION_PORT) {
+			*ports = StateReader (data + offset, length);
+		}
+	}
+	return r.ok ();
 }
 
-static LV2_State_Status store_callback (
-		LV2_State_Handle handle,
-		uint32_t         key,
-		const void*      value,
-		size_t           size,
-		uint32_t         type,
-		uint32_t         flags)
+LV2Plugin::LV2State* LV2Plugin::unserialize_state (const void* data, size_t s)
 {
-	LV2Plugin::LV2State* const state = (LV2Plugin::LV2State*)handle;
-	state->props = (LV2Plugin::LV2PortProperty*) realloc (state->props, (state->n_props + 1) * sizeof (LV2Plugin::LV2PortProperty));
-	LV2Plugin::LV2PortProperty* const prop = &state->props[state->n_props];
-	++state->n_props;
+	StateReader props (NULL, 0);
+	StateReader ports (NULL, 0);
+	uint32_t version;
+	if (!parse_container ((const uint8_t*) data, s, &version, &props, &ports)) {
+		return NULL;
+	}
 
-	if (flags & LV2_STATE_IS_POD) {
-		prop->value = malloc (size);
-		memcpy (prop->value, value, size);
-	} else {
-		prop->value = (void*)value;
+	/* 1st pass: validate, and size property values and strings */
+	StateReader r = props;
+	const uint32_t n_props = r.get_uint ();
+	size_t value_size  = 0;
+	size_t string_size = 0;
+	for (uint32_t i = 0; i < n_props && r.ok (); ++i) {
+		uint32_t len;
+		r.get_string (&len);
+		string_size += len + 1;
+		r.get_string (&len);
+		string_size += len + 1;
+		r.get_uint (); // flags
+		len = r.get_uint ();
+		r.get (len);
+		value_size += align8 (len);
+	}
+	/* an absent PROP section is fine */
+	const bool has_props = r.ok ();
+
+	r = ports;
+	const uint32_t n_values = r.get_uint ();
+	for (uint32_t i = 0; i < n_values && r.ok (); ++i) {
+		uint32_t len;
+		r.get_float ();
+		r.get_string (&len);
+		string_size += len + 1;
+	}
+	const bool has_ports = r.ok ();
+
+	if ((!has_props && n_props > 0) || (!has_ports && n_values > 0)) {
+		fprintf (stderr, "LV2Host: state is corrupt\n");
+		return NULL;
+	}
+
+	uint32_t n_index = 4;
+	while (n_index < 2 * n_props) {
+		n_index <<= 1;
+	}
+
+	const size_t props_offset  = align8 (sizeof (LV2State));
+	const size_t values_offset = props_offset + align8 (n_props * sizeof (LV2PortProperty));
+	const size_t index_offset  = values_offset + align8 (n_values * sizeof (LV2PortValue));
+	const size_t arena_offset  = index_offset + align8 (n_index * sizeof (uint32_t));
+
+	uint8_t* mem = (uint8_t*) malloc (arena_offset + value_size + string_size);
+	if (!mem) {
+		return NULL;
 	}
 
-	prop->size  = size;
-	prop->key   = key;
-	prop->type  = type;
-	prop->flags = flags;
+	LV2State* const state = (LV2State*) mem;
+	state->n_props  = n_props;
+	state->n_values = n_values;
+	state->props    = (LV2PortProperty*) (mem + props_offset);
+	state->values   = (LV2PortValue*) (mem + values_offset);
+	state->prop_index = (uint32_t*) (mem + index_offset);
+	state->prop_mask  = n_index - 1;
+	memset (state->prop_index, 0xff, n_index * sizeof (uint32_t));
+	uint8_t* values  = mem + arena_offset;
+	uint8_t* strings = values + value_size;
+
+	/* 2nd pass: fill in */
+	r = props;
+	r.get_uint ();
+	for (uint32_t i = 0; i < n_props; ++i) {
+		LV2PortProperty *p = &state->props[i];
+		p->key   = _map.uri_to_id (copy_string (r, &strings));
+		const char* type_uri = copy_string (r, &strings);
+		p->type  = _map.uri_to_id (type_uri);
+		p->flags = r.get_uint ();
+		p->size  = r.get_uint ();
+		p->value = values;
+		if (version > 1 && scalar_size (type_uri, p->size)) {
+			swap_scalar (values, r.get (p->size), p->size);
+		} else {
+			memcpy (values, r.get (p->size), p->size);
+		}
+		values += align8 (p->size);
 
-	return LV2_STATE_SUCCESS;
+		/* the first of duplicate keys wins */
+		uint32_t h = urid_hash (p->key) & state->prop_mask;
+		while (state->prop_index[h] != UINT32_MAX && state->props[state->prop_index[h]].key != p->key) {
+			h = (h + 1) & state->prop_mask;
+		}
+		if (state->prop_index[h] == UINT32_MAX) {
+			state->prop_index[h] = i;
+		}
+	}
+	r = ports;
+	r.get_uint ();
+	for (uint32_t i = 0; i < n_values; ++i) {
+		LV2PortValue *p = &state->values[i];
+		p->value  = r.get_float ();
+		p->symbol = copy_string (r, &strings);
+	}
+	return state;
 }
 
 static const void*
@@ -188,9 +491,9 @@ retrieve_callback (LV2_State_Handle handle,
 {
 	LV2Plugin::LV2State* const state = (LV2Plugin::LV2State*)handle;
 	LV2Plugin::LV2PortProperty const* prop = NULL;
-	for (uint32_t i = 0; i < state->n_props; ++i) {
-		if (state->props[i].key == key) {
-			prop = &state->props[i];
+	for (uint32_t h = urid_hash (key) & state->prop_mask; state->prop_index[h] != UINT32_MAX; h = (h + 1) & state->prop_mask) {
+		if (state->props[state->prop_index[h]].key == key) {
+			prop = &state->props[state->prop_index[h]];
 			break;
 		}
 	}
@@ -204,18 +507,28 @@ retrieve_callback (LV2_State_Handle handle,
 	return NULL;
 }
 
+/* ****************************************************************************
+ * LV2Plugin API
+ */
+
+// TODO use .ttl instead (save LV2 presets) ??
 int32_t LV2Plugin::save_state (void** data)
 {
-	LV2State* const state = (LV2State*)calloc (1, sizeof (LV2State));
+	/* control values are known in advance, size for them and some properties */
+	size_t initial = STATE_HEADER + 7 * sizeof (uint32_t) + 2 * sizeof (uint32_t) + 4096;
+	for (uint32_t i = 0; i < _desc->nports_ctrl_in; ++i) {
+		initial += sizeof (float) + sizeof (uint32_t) + strlen (_desc->ports[_ctrl_in_port[i]].symbol);
+	}
 
-	for (uint32_t p = 0; p < _desc->nports_total; ++p) {
-		if (_desc->ports[p].porttype != CONTROL_IN) {
-			continue;
-		}
-		state->values = (LV2PortValue*) realloc (state->values, (state->n_values + 1) * sizeof (LV2PortValue));
-		state->values[state->n_values].value = _ports[p];
-		state->values[state->n_values].symbol = strdup (_desc->ports[p].symbol);
-		++state->n_values;
+	StateWriter w (initial);
+	w.put (STATE_MAGIC, 4);
+	w.put_uint (STATE_VERSION);
+	w.put_uint (0); // size, set below
+	w.put_uint (0); // checksum, set below
+	w.put_uint (2); // sections
+	const size_t table = w.used ();
+	for (int i = 0; i < 6; ++i) {
+		w.put_uint (0);
 	}
 
 	const LV2_State_Interface* iface = NULL;
@@ -228,19 +541,50 @@ int32_t LV2Plugin::save_state (void** data)
 	 * e.g. save file -- then serialize file and include in blob
 	 * in VST fashion.
 	 */
+	const size_t props = w.used ();
+	w.put_uint (0); // count, set below
+	StoreHandle sh = { &w, &_map, 0 };
 	if (iface && iface->save) {
-		LV2_State_Status st = iface->save (_plugin_instance, store_callback, state, 0, NULL);
+		LV2_State_Status st = iface->save (_plugin_instance, store_callback, &sh, 0, NULL);
 		if (st != LV2_STATE_SUCCESS) {
 			fprintf (stderr, "LV2Host: Error saving plugin state\n");
 		}
 	}
+	w.set_uint (props, sh.n_props);
+
+	/* lv2:freeWheeling is set by the host, it is not part of the state */
+	const size_t ports = w.used ();
+	const bool has_freewheel = _desc->freewheel_ctrl_port != UINT32_MAX;
+	w.put_uint (_desc->nports_ctrl_in - (has_freewheel ? 1 : 0));
+	for (uint32_t i = 0; i < _desc->nports_ctrl_in; ++i) {
+		if (_ctrl_in_port[i] == _desc->freewheel_ctrl_port) {
+			continue;
+		}
+		w.put_float (_ctrl_in[i]);
+		w.put_string (_desc->ports[_ctrl_in_port[i]].symbol);
+	}
 
-	size_t sz = serialize_state (state, data);
-	free_lv2state (state);
-	return sz;
+	const size_t end = w.used ();
+	w.set_uint (table,      SECTION_PROP);
+	w.set_uint (table + 4,  props);
+	w.set_uint (table + 8,  ports - props);
+	w.set_uint (table + 12, SECTION_PORT);
+	w.set_uint (table + 16, ports);
+	w.set_uint (table + 20, end - ports);
+	w.set_uint (8, end);
+	if (!w.failed ()) {
+		w.set_uint (12, adler32 (w.data () + STATE_HEADER, end - STATE_HEADER));
+	}
+
+	if (w.failed ()) {
+		*data = NULL;
+		return 0;
+	}
+	*data = w.release ();
+	return w.used ();
 }
 
-int32_t LV2Plugin::load_state (void* data, int32_t size)
+int32_t LV2Plugin::load_state (const void* data, int32_t size)
 {
 	LV2State* const state = unserialize_state (data, size);
 	if (!state) {
@@ -249,26 +593,7 @@ int32_t LV2Plugin::load_state (void* data, int32_t size)
 	}
 
 	for (uint32_t i = 0; i < state->n_values; ++i) {
-		LV2PortValue *pv = &state->values[i];
-		for (uint32_t p = 0; p < _desc->nports_total; ++p) {
-			if (_desc->ports[p].porttype != CONTROL_IN) {
-				continue;
-			}
-			if (strcmp (_desc->ports[p].symbol, pv->symbol)) {
-				continue;
-			}
-			if (_ports[p] == pv->value) {
-				continue;
-			}
-
-			_ports[p] = pv->value;
-			if (_ui.is_open ()) {
-				if (ctrl_to_ui.write_space () > 0) {
-					ParamVal pv (p, _ports[p]);
-					ctrl_to_ui.write (&pv, 1);
-				}
-			}
-		}
+		restore_port (state->values[i].symbol, state->values[i].value);
 	}
 
 	const LV2_State_Interface* iface = NULL;
@@ -279,6 +604,67 @@ int32_t LV2Plugin::load_state (void* data, int32_t size)
 		iface->restore (_plugin_instance, retrieve_callback, (LV2_State_Handle)state, 0, NULL);
 	}
 
-	free_lv2state (state);
+	free (state);
 	return 0;
 }
+
+bool LV2Plugin::has_preset (const char* uri) const
+{
+	return preset_by_uri (_desc, uri) != NULL;
+}
+
+/* the preset is parsed before it is applied, restore () is not called
+ * concurrently with process () */
+bool LV2Plugin::load_preset (LV2Plugin* const* plugins, unsigned int n_plugins, const char* uri)
+{
+	LilvState* state = preset_load (plugins[0]->_desc, uri, &plugins[0]->uri_map);
+	if (!state) {
+		fprintf (stderr, "LV2Host: failed to load preset '%s'\n", uri);
+		return false;
+	}
+	for (unsigned int k = 0; k < n_plugins; ++k) {
+		LilvInstance instance = { plugins[k]->_plugin_dsp, plugins[k]->_plugin_instance, NULL };
+		lilv_state_restore (state, &instance, set_preset_value, plugins[k], 0, NULL);
+	}
+	preset_free (state);
+	return true;
+}
+
+void LV2Plugin::set_preset_value (const char* symbol, void* handle, const void* value, uint32_t size, uint32_t type)
+{
+	LV2Plugin* self = (LV2Plugin*) handle;
+	float v;
+	if (type == self->_uri.atom_Float && size == sizeof (float)) {
+		v = *(const float*) value;
+	} else if (type == self->_uri.atom_Double && size == sizeof (double)) {
+		v = *(const double*) value;
+	} else if (type == self->_uri.atom_Int && size == sizeof (int32_t)) {
+		v = *(const int32_t*) value;
+	} else if (type == self->_uri.atom_Long && size == sizeof (int64_t)) {
+		v = *(const int64_t*) value;
+	} else {
+		fprintf (stderr, "LV2Host: preset value for '%s' has unsupported type\n", symbol);
+		return;
+	}
+	self->restore_port (symbol, v);
+}
+
+void LV2Plugin::restore_port (const char* symbol, float value)
+{
+	const uint32_t p = port_by_symbol (_desc, symbol);
+	if (p == UINT32_MAX || _desc->ports[p].porttype != CONTROL_IN || p == _desc->freewheel_ctrl_port) {
+		return;
+	}
+	const uint32_t c = _ctrl_slot[p];
+	if (_ctrl_in[c] == value) {
+		return;
+	}
+
+	_ctrl_in[c] = value;
+	if (_ui.is_open ()) {
+		if (ctrl_to_ui.write_space () > 0) {
+			ParamVal pv (p, _ctrl_in[c]);
+			ctrl_to_ui.write (&pv, 1);
+		}
+	}
+}
@@ -0,0 +1,150 @@
+/*
+ *  Copyright (C) 2016 Robin Gareus <robin@gareus.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
+
+#include "atomicfile.h"
+#include "statestore.h"
+
+#define STATE_HEADER "LV2VLC-STATE 1\n"
+
+static char* state_file (const char* dir, const char* uri, unsigned int instance)
+{
+	/* 64bit FNV-1a */
+	uint64_t h = 14695981039346656037ULL;
+	for (const char* c = uri; *c; ++c) {
+		h = (h ^ (uint8_t)*c) * 1099511628211ULL;
+	}
+	size_t len = strlen (dir) + 48;
+	char* file = (char*) malloc (len);
+	if (!file) {
+		return NULL;
+	}
+	if (instance == 0) {
+		snprintf (file, len, "%s/%016llx.state", dir, (unsigned long long) h);
+	} else {
+		snprintf (file, len, "%s/%016llx-%u.state", dir, (unsigned long long) h, instance);
+	}
+	return file;
+}
+
+bool state_store_save (const char* dir, const char* uri, unsigned int instance, const void* data, size_t size)
+{
+	char* file = state_file (dir, uri, instance);
+	if (!file) {
+		return false;
+	}
+	/* concurrent instances of the filter each write their own file */
+	char* tmp = NULL;
+	FILE* f = atomic_write_open (file, &tmp);
+	if (!f) {
+		free (file);
+		return false;
+	}
+
+	fprintf (f, "%s%s\n", STATE_HEADER, uri);
+	fwrite (data, 1, size, f);
+
+	bool ok = atomic_write_commit (f, tmp, file);
+	free (file);
+	return ok;
+}
+
+Lv2StateFile* state_store_load (const char* dir, const char* uri, unsigned int instance)
+{
+	char* file = state_file (dir, uri, instance);
+	if (!file) {
+		return NULL;
+	}
+
+	Lv2StateFile* sf = (Lv2StateFile*) calloc (1, sizeof (Lv2StateFile));
+	if (!sf) {
+		free (file);
+		return NULL;
+	}
+
+#ifdef _WIN32
+	/* no mmap, read the file */
+	FILE* f = fopen (file, "rb");
+	long fsize = 0;
+	if (f && fseek (f, 0, SEEK_END) == 0 && (fsize = ftell (f)) > 0 && fseek (f, 0, SEEK_SET) == 0) {
+		sf->map = malloc (fsize);
+		if (sf->map && fread (sf->map, 1, fsize, f) == (size_t)fsize) {
+			sf->map_size = fsize;
+		}
+	}
+	if (f) {
+		fclose (f);
+	}
+#else
+	int fd = open (file, O_RDONLY);
+	struct stat st;
+	if (fd >= 0 && fstat (fd, &st) == 0 && st.st_size > 0) {
+		void* m = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (m != MAP_FAILED) {
+			sf->map = m;
+			sf->map_size = st.st_size;
+		}
+	}
+	if (fd >= 0) {
+		close (fd);
+	}
+#endif
+	free (file);
+
+	/* verify the header, the hash may collide */
+	const size_t hl = strlen (STATE_HEADER);
+	const size_t ul = strlen (uri);
+	const char* m = (const char*) sf->map;
+	if (sf->map_size < hl + ul + 1
+			|| memcmp (m, STATE_HEADER, hl)
+			|| memcmp (m + hl, uri, ul)
+			|| m[hl + ul] != '\n') {
+		state_store_release (sf);
+		return NULL;
+	}
+
+	sf->data = m + hl + ul + 1;
+	sf->size = sf->map_size - (hl + ul + 1);
+	return sf;
+}
+
+void state_store_release (Lv2StateFile* sf)
+{
+	if (!sf) {
+		return;
+	}
+#ifdef _WIN32
+	free (sf->map);
+#else
+	if (sf->map) {
+		munmap (sf->map, sf->map_size);
+	}
+#endif
+	free (sf);
+}
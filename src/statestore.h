@@ -0,0 +1,47 @@
+/*
+ *  Copyright (C) 2016 Robin Gareus <robin@gareus.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _statestore_h_
+#define _statestore_h_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* persistent plugin state, one file per plugin URI and instance.
+ *
+ * Files are named after a hash of the URI, and start with a short
+ * header that repeats the URI, followed by the state blob
+ * (LV2Plugin::save_state). The instance counts earlier occurrences of
+ * the same plugin in the chain, so that each one keeps its own state. */
+
+typedef struct {
+	const void* data; // state blob, read-only
+	size_t      size;
+	void*       map;  // mapping, includes the header
+	size_t      map_size;
+} Lv2StateFile;
+
+/* atomically replace the state of the given plugin */
+bool state_store_save (const char* dir, const char* uri, unsigned int instance, const void* data, size_t size);
+
+/* map the state of the given plugin, returns NULL if there is none */
+Lv2StateFile* state_store_load (const char* dir, const char* uri, unsigned int instance);
+
+void state_store_release (Lv2StateFile* sf);
+
+#endif
@@ -0,0 +1,313 @@
+/*
+ *  Copyright (C) 2016 Robin Gareus <robin@gareus.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "lv2/lv2plug.in/ns/ext/uri-map/uri-map.h"
+#include "uri_map.h"
+#include "uri_table.h"
+
+using namespace Lv2Vlc;
+
+__thread bool Lv2UriMap::rt_thread = false;
+
+Lv2UriMap::Lv2UriMap ()
+	: _n_uris (0)
+	, _table (NULL)
+	, _arena (NULL)
+	, _arena_used (0)
+	, _arena_size (0)
+{
+	memset (_pages, 0, sizeof (_pages));
+	vlc_mutex_init (&_lock);
+	reserve ();
+}
+
+Lv2UriMap::~Lv2UriMap ()
+{
+	while (_table) {
+		Table* t = _table->retired;
+		free (_table);
+		_table = t;
+	}
+	for (uint32_t p = 0; p < max_pages && _pages[p]; ++p) {
+		free (_pages[p]);
+	}
+	while (_arena) {
+		char* prev = *(char**)_arena;
+		free (_arena);
+		_arena = prev;
+	}
+	vlc_mutex_destroy (&_lock);
+}
+
+/* FNV-1a */
+uint32_t Lv2UriMap::hash_uri (const char* uri)
+{
+	uint32_t h = 2166136261u;
+	for (const unsigned char* c = (const unsigned char*) uri; *c; ++c) {
+		h = (h ^ *c) * 16777619u;
+	}
+	return h;
+}
+
+/* must match uri_hash () in update_uri_table.py */
+static uint32_t hash_static (const char* uri, uint32_t seed)
+{
+	uint32_t h = 2166136261u ^ (seed * 0x9e3779b9u);
+	for (const unsigned char* c = (const unsigned char*) uri; *c; ++c) {
+		h = (h ^ *c) * 16777619u;
+	}
+	h ^= h >> 15;
+	h *= 0x2c1b3c6du;
+	h ^= h >> 12;
+	return h;
+}
+
+/* well-known URIs have fixed IDs 1 .. N_STATIC_URIS, perfect hash lookup */
+LV2_URID Lv2UriMap::find_static (const char* uri)
+{
+	const uint32_t b = hash_static (uri, 0) % N_STATIC_BUCKETS;
+	const uint32_t s = hash_static (uri, static_uri_disp[b]) & (N_STATIC_SLOTS - 1);
+	const LV2_URID id = static_uri_slot[s];
+	if (id && !strcmp (static_uris[id - 1], uri)) {
+		return id;
+	}
+	return 0;
+}
+
+/* dynamic entry of `id` > N_STATIC_URIS */
+const Lv2UriMap::Entry* Lv2UriMap::entry (LV2_URID id) const
+{
+	const uint32_t k = id - N_STATIC_URIS - 1;
+	const Entry* page = __atomic_load_n (&_pages[k >> page_bits], __ATOMIC_ACQUIRE);
+	return &page[k & (page_size - 1)];
+}
+
+/* wait-free: the table only ever changes from empty to set slots */
+LV2_URID Lv2UriMap::find (const Table* t, const char* uri, uint32_t hash) const
+{
+	if (!t) {
+		return 0;
+	}
+	for (uint32_t i = hash & t->mask;; i = (i + 1) & t->mask) {
+		const LV2_URID id = __atomic_load_n (&t->slots[i], __ATOMIC_ACQUIRE);
+		if (id == 0) {
+			return 0;
+		}
+		const Entry* e = entry (id);
+		if (e->hash == hash && !strcmp (e->uri, uri)) {
+			return id;
+		}
+	}
+}
+
+LV2_URID Lv2UriMap::uri_to_id (const char* uri)
+{
+	if (rt_thread) {
+		return uri_to_id_rt (uri);
+	}
+
+	LV2_URID id = find_static (uri);
+	if (id) {
+		return id;
+	}
+
+	const uint32_t hash = hash_uri (uri);
+	id = find (__atomic_load_n (&_table, __ATOMIC_ACQUIRE), uri, hash);
+	if (id) {
+		return id;
+	}
+
+	vlc_mutex_lock (&_lock);
+	/* another thread may have mapped it meanwhile */
+	id = find (_table, uri, hash);
+	if (!id) {
+		id = insert (uri, hash, false);
+		/* replenish what RT threads may have used */
+		reserve ();
+	}
+	vlc_mutex_unlock (&_lock);
+	return id;
+}
+
+/* never blocks or allocates, returns 0 if the URI cannot be mapped now */
+LV2_URID Lv2UriMap::uri_to_id_rt (const char* uri)
+{
+	LV2_URID id = find_static (uri);
+	if (id) {
+		return id;
+	}
+
+	const uint32_t hash = hash_uri (uri);
+	id = find (__atomic_load_n (&_table, __ATOMIC_ACQUIRE), uri, hash);
+	if (id) {
+		return id;
+	}
+
+	if (vlc_mutex_trylock (&_lock)) {
+		return 0;
+	}
+	id = find (_table, uri, hash);
+	if (!id) {
+		id = insert (uri, hash, true);
+	}
+	vlc_mutex_unlock (&_lock);
+	return id;
+}
+
+/* called with _lock held, or from the c'tor */
+void Lv2UriMap::reserve ()
+{
+	const uint32_t n = _n_uris + rt_reserve;
+	while (!_table || 2 * n > _table->mask + 1) {
+		if (!grow ()) {
+			return;
+		}
+	}
+	for (uint32_t page = _n_uris >> page_bits; page <= (n - 1) >> page_bits && page < max_pages; ++page) {
+		if (!_pages[page]) {
+			Entry* p = (Entry*) calloc (page_size, sizeof (Entry));
+			if (!p) {
+				return;
+			}
+			__atomic_store_n (&_pages[page], p, __ATOMIC_RELEASE);
+		}
+	}
+	if (!_arena || _arena_used + rt_arena > _arena_size) {
+		arena_chunk (rt_arena);
+	}
+}
+
+const char* Lv2UriMap::id_to_uri (LV2_URID i)
+{
+	if (i > 0 && i <= N_STATIC_URIS) {
+		return static_uris[i - 1];
+	}
+	const uint32_t n_uris = __atomic_load_n (&_n_uris, __ATOMIC_ACQUIRE);
+	assert (i > 0 && i <= N_STATIC_URIS + n_uris);
+	if (i == 0 || i > N_STATIC_URIS + n_uris) {
+		fprintf (stderr, "LV2Host: invalid URID lookup\n");
+		return NULL;
+	}
+	return entry (i)->uri;
+}
+
+/* called with _lock held. With `rt` set, only reserved space is used */
+LV2_URID Lv2UriMap::insert (const char* uri, uint32_t hash, bool rt)
+{
+	const uint32_t k = _n_uris;
+	const LV2_URID id = N_STATIC_URIS + k + 1;
+	const uint32_t page = k >> page_bits;
+	if (page >= max_pages) {
+		fprintf (stderr, "LV2Host: too many URIs\n");
+		return 0;
+	}
+	/* keep the load-factor below 1/2 */
+	if ((!_table || 2 * (k + 1) > _table->mask + 1) && (rt || !grow ())) {
+		return 0;
+	}
+	if (!_pages[page]) {
+		if (rt) {
+			return 0;
+		}
+		Entry* p = (Entry*) calloc (page_size, sizeof (Entry));
+		if (!p) {
+			return 0;
+		}
+		__atomic_store_n (&_pages[page], p, __ATOMIC_RELEASE);
+	}
+
+	Entry* e = &_pages[page][k & (page_size - 1)];
+	e->uri  = arena_strdup (uri, rt);
+	e->hash = hash;
+	if (!e->uri) {
+		return 0;
+	}
+	__atomic_store_n (&_n_uris, k + 1, __ATOMIC_RELEASE);
+
+	Table* t = _table;
+	uint32_t i = hash & t->mask;
+	while (t->slots[i] != 0) {
+		i = (i + 1) & t->mask;
+	}
+	/* publish, the entry is complete */
+	__atomic_store_n (&t->slots[i], id, __ATOMIC_RELEASE);
+	return id;
+}
+
+/* called with _lock held, before the next entry is added.
+ * On failure the current table is kept. */
+bool Lv2UriMap::grow ()
+{
+	const uint32_t size = _table ? 2 * (_table->mask + 1) : 128;
+	Table* t = (Table*) calloc (1, sizeof (Table) + (size - 1) * sizeof (LV2_URID));
+	if (!t) {
+		return false;
+	}
+	t->mask = size - 1;
+	t->retired = _table;
+
+	for (LV2_URID id = N_STATIC_URIS + 1; id <= N_STATIC_URIS + _n_uris; ++id) {
+		uint32_t i = entry (id)->hash & t->mask;
+		while (t->slots[i] != 0) {
+			i = (i + 1) & t->mask;
+		}
+		t->slots[i] = id;
+	}
+	/* readers may still probe the old table, it is freed with the map */
+	__atomic_store_n (&_table, t, __ATOMIC_RELEASE);
+	return true;
+}
+
+/* Strings are packed into chunks, a new chunk is started when
+ * the current one is full. Each chunk starts with a pointer
+ * to the previous one. Called with _lock held. */
+bool Lv2UriMap::arena_chunk (size_t len)
+{
+	size_t size = 4096;
+	while (size < len + sizeof (char*)) {
+		size *= 2;
+	}
+	char* chunk = (char*) malloc (size);
+	if (!chunk) {
+		return false;
+	}
+	*(char**)chunk = _arena;
+	_arena      = chunk;
+	_arena_used = sizeof (char*);
+	_arena_size = size;
+	return true;
+}
+
+char* Lv2UriMap::arena_strdup (const char* uri, bool rt)
+{
+	const size_t len = strlen (uri) + 1;
+	if (!_arena || _arena_used + len > _arena_size) {
+		if (rt || !arena_chunk (len)) {
+			return NULL;
+		}
+	}
+	char* rv = _arena + _arena_used;
+	memcpy (rv, uri, len);
+	_arena_used += len;
+	return rv;
+}
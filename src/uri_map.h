@@ -19,15 +19,40 @@
 #ifndef _uri_map_h
 #define _uri_map_h
 
+#include <vlc_common.h>
+#include <vlc_threads.h>
+
 #include "lv2/lv2plug.in/ns/ext/urid/urid.h"
 
 namespace Lv2Vlc {
 
+/* URI <> URID interner, shared by the plugin, its UI and worker threads.
+ *
+ * Looking up an URI that is already mapped, and id_to_uri () are
+ * wait-free and do not allocate, so they are safe to call from the
+ * audio thread.
+ *
+ * Mapping a new URI takes a lock. On threads inside an RtScope (the
+ * processing threads) uri_to_id () uses uri_to_id_rt () instead: that
+ * only try-locks, and only uses table slots, a page and arena space that
+ * reserve () set aside beforehand. It returns 0 if the lock is contended
+ * or the reserve is exhausted, it never blocks or allocates. reserve ()
+ * is called when the map is created and after every insert on a non-RT
+ * thread.
+ *
+ * URIs are found via an open-addressing hash table (linear probing).
+ * When the table grows, a new one is published and the old one is kept
+ * until the map is destroyed, since readers may still use it.
+ * Strings are kept in an append-only arena and the id -> URI entries in
+ * fixed size pages, so neither ever moves.
+ *
+ * Well-known URIs (src/uri_table.h) have fixed IDs and are resolved
+ * via a perfect hash, before the dynamic table is consulted. */
 class Lv2UriMap
 {
 	public:
-		Lv2UriMap () : urimap (NULL) , urimap_len (0) {}
-		~Lv2UriMap () { free_uri_map (); }
+		Lv2UriMap ();
+		~Lv2UriMap ();
 
 		static LV2_URID uri_to_id (LV2_URI_Map_Callback_Data callback_data, const char* uri) {
 			Lv2UriMap* self = (Lv2UriMap*) callback_data;
@@ -39,41 +64,58 @@ class Lv2UriMap
 			return self->id_to_uri (urid);
 		}
 
-		LV2_URID uri_to_id (const char* uri) {
-			for (uint32_t i = 0; i < urimap_len; ++i) {
-				if (!strcmp (urimap[i], uri)) {
-					//printf("Found mapped URI '%s' -> %d\n", uri, i + 1);
-					return i + 1;
-				}
-			}
-			//printf("map URI '%s' -> %d\n", uri, urimap_len + 1);
-			urimap = (char**) realloc (urimap, (urimap_len + 1) * sizeof (char*));
-			urimap[urimap_len] = strdup (uri);
-			return ++urimap_len;
-		}
+		LV2_URID uri_to_id (const char* uri);
+		LV2_URID uri_to_id_rt (const char* uri);
+		const char* id_to_uri (LV2_URID i);
 
-		const char* id_to_uri (LV2_URID i) {
-			assert (i > 0 && i <= urimap_len);
-			if (i == 0 || i > urimap_len) {
-				fprintf (stderr, "LV2Host: invalid URID lookup\n");
-				return NULL;
-			}
-			//printf("lookup URI %d -> '%s'\n", i, urimap[i - 1]);
-			return urimap[i - 1];
-		}
+		/* set aside room to map `rt_reserve` URIs on RT threads, non-RT only */
+		void reserve ();
+
+		/* marks the current thread as RT while in scope */
+		class RtScope {
+			public:
+				RtScope ()  { rt_thread = true; }
+				~RtScope () { rt_thread = false; }
+		};
 
 	private:
-		void free_uri_map () {
-			for (uint32_t i = 0; i < urimap_len; ++i) {
-				free (urimap[i]);
-			}
-			free (urimap);
-			urimap = NULL;
-			urimap_len = 0;
-		}
+		struct Entry {
+			const char* uri;
+			uint32_t    hash;
+		};
+
+		struct Table {
+			Table*   retired;  // previous (smaller) table
+			uint32_t mask;
+			LV2_URID slots[1]; // [mask + 1], 0: empty
+		};
+
+		static const uint32_t page_bits = 8;
+		static const uint32_t page_size = 1 << page_bits;
+		static const uint32_t max_pages = 4096;
+		static const uint32_t rt_reserve = 64;    // URIs
+		static const size_t   rt_arena   = 4096;  // bytes
+
+		static __thread bool rt_thread;
+
+		static uint32_t hash_uri (const char* uri);
+		static LV2_URID find_static (const char* uri);
+
+		LV2_URID find (const Table* t, const char* uri, uint32_t hash) const;
+		const Entry* entry (LV2_URID id) const;
+		LV2_URID insert (const char* uri, uint32_t hash, bool rt);
+		bool grow ();
+		bool arena_chunk (size_t len);
+		char* arena_strdup (const char* uri, bool rt);
+
+		Entry*       _pages[max_pages]; // (id - 1) >> page_bits
+		uint32_t     _n_uris;           // atomic, number of dynamic URIs, published after the entry
+		Table*       _table;            // atomic
 
-		char **urimap;
-		uint32_t urimap_len;
+		vlc_mutex_t  _lock;             // serializes insertion
+		char*        _arena;
+		size_t       _arena_used;
+		size_t       _arena_size;
 };
 
 } /* namespace */
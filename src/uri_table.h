@@ -0,0 +1,164 @@
+/* generated by update_uri_table.py -- do not edit */
+
+#ifndef _uri_table_h_
+#define _uri_table_h_
+
+#define N_STATIC_URIS 122
+#define N_STATIC_BUCKETS 61
+#define N_STATIC_SLOTS 256
+
+/* URID = index + 1 */
+static const char* const static_uris[N_STATIC_URIS] = {
+	"http://lv2plug.in/ns/ext/atom#Atom",
+	"http://lv2plug.in/ns/ext/atom#AtomPort",
+	"http://lv2plug.in/ns/ext/atom#Blank",
+	"http://lv2plug.in/ns/ext/atom#Bool",
+	"http://lv2plug.in/ns/ext/atom#Chunk",
+	"http://lv2plug.in/ns/ext/atom#Double",
+	"http://lv2plug.in/ns/ext/atom#Event",
+	"http://lv2plug.in/ns/ext/atom#Float",
+	"http://lv2plug.in/ns/ext/atom#Int",
+	"http://lv2plug.in/ns/ext/atom#Literal",
+	"http://lv2plug.in/ns/ext/atom#Long",
+	"http://lv2plug.in/ns/ext/atom#Number",
+	"http://lv2plug.in/ns/ext/atom#Object",
+	"http://lv2plug.in/ns/ext/atom#Path",
+	"http://lv2plug.in/ns/ext/atom#Property",
+	"http://lv2plug.in/ns/ext/atom#Resource",
+	"http://lv2plug.in/ns/ext/atom#Sequence",
+	"http://lv2plug.in/ns/ext/atom#Sound",
+	"http://lv2plug.in/ns/ext/atom#String",
+	"http://lv2plug.in/ns/ext/atom#Tuple",
+	"http://lv2plug.in/ns/ext/atom#URI",
+	"http://lv2plug.in/ns/ext/atom#URID",
+	"http://lv2plug.in/ns/ext/atom#Vector",
+	"http://lv2plug.in/ns/ext/atom#atomTransfer",
+	"http://lv2plug.in/ns/ext/atom#beatTime",
+	"http://lv2plug.in/ns/ext/atom#bufferType",
+	"http://lv2plug.in/ns/ext/atom#childType",
+	"http://lv2plug.in/ns/ext/atom#eventTransfer",
+	"http://lv2plug.in/ns/ext/atom#frameTime",
+	"http://lv2plug.in/ns/ext/atom#supports",
+	"http://lv2plug.in/ns/ext/atom#timeUnit",
+	"http://lv2plug.in/ns/ext/buf-size#boundedBlockLength",
+	"http://lv2plug.in/ns/ext/buf-size#fixedBlockLength",
+	"http://lv2plug.in/ns/ext/buf-size#maxBlockLength",
+	"http://lv2plug.in/ns/ext/buf-size#minBlockLength",
+	"http://lv2plug.in/ns/ext/buf-size#nominalBlockLength",
+	"http://lv2plug.in/ns/ext/buf-size#powerOf2BlockLength",
+	"http://lv2plug.in/ns/ext/buf-size#sequenceSize",
+	"http://lv2plug.in/ns/ext/midi#MidiEvent",
+	"http://lv2plug.in/ns/ext/time#Time",
+	"http://lv2plug.in/ns/ext/time#Position",
+	"http://lv2plug.in/ns/ext/time#Rate",
+	"http://lv2plug.in/ns/ext/time#position",
+	"http://lv2plug.in/ns/ext/time#barBeat",
+	"http://lv2plug.in/ns/ext/time#bar",
+	"http://lv2plug.in/ns/ext/time#beat",
+	"http://lv2plug.in/ns/ext/time#beatUnit",
+	"http://lv2plug.in/ns/ext/time#beatsPerBar",
+	"http://lv2plug.in/ns/ext/time#beatsPerMinute",
+	"http://lv2plug.in/ns/ext/time#frame",
+	"http://lv2plug.in/ns/ext/time#framesPerSecond",
+	"http://lv2plug.in/ns/ext/time#speed",
+	"http://lv2plug.in/ns/ext/patch#Ack",
+	"http://lv2plug.in/ns/ext/patch#Delete",
+	"http://lv2plug.in/ns/ext/patch#Copy",
+	"http://lv2plug.in/ns/ext/patch#Error",
+	"http://lv2plug.in/ns/ext/patch#Get",
+	"http://lv2plug.in/ns/ext/patch#Message",
+	"http://lv2plug.in/ns/ext/patch#Move",
+	"http://lv2plug.in/ns/ext/patch#Patch",
+	"http://lv2plug.in/ns/ext/patch#Post",
+	"http://lv2plug.in/ns/ext/patch#Put",
+	"http://lv2plug.in/ns/ext/patch#Request",
+	"http://lv2plug.in/ns/ext/patch#Response",
+	"http://lv2plug.in/ns/ext/patch#Set",
+	"http://lv2plug.in/ns/ext/patch#add",
+	"http://lv2plug.in/ns/ext/patch#body",
+	"http://lv2plug.in/ns/ext/patch#destination",
+	"http://lv2plug.in/ns/ext/patch#property",
+	"http://lv2plug.in/ns/ext/patch#readable",
+	"http://lv2plug.in/ns/ext/patch#remove",
+	"http://lv2plug.in/ns/ext/patch#request",
+	"http://lv2plug.in/ns/ext/patch#subject",
+	"http://lv2plug.in/ns/ext/patch#sequenceNumber",
+	"http://lv2plug.in/ns/ext/patch#value",
+	"http://lv2plug.in/ns/ext/patch#wildcard",
+	"http://lv2plug.in/ns/ext/patch#writable",
+	"http://lv2plug.in/ns/ext/parameters#CompressorControls",
+	"http://lv2plug.in/ns/ext/parameters#ControlGroup",
+	"http://lv2plug.in/ns/ext/parameters#EnvelopeControls",
+	"http://lv2plug.in/ns/ext/parameters#FilterControls",
+	"http://lv2plug.in/ns/ext/parameters#OscillatorControls",
+	"http://lv2plug.in/ns/ext/parameters#amplitude",
+	"http://lv2plug.in/ns/ext/parameters#attack",
+	"http://lv2plug.in/ns/ext/parameters#bypass",
+	"http://lv2plug.in/ns/ext/parameters#cutoffFrequency",
+	"http://lv2plug.in/ns/ext/parameters#decay",
+	"http://lv2plug.in/ns/ext/parameters#delay",
+	"http://lv2plug.in/ns/ext/parameters#dryLevel",
+	"http://lv2plug.in/ns/ext/parameters#frequency",
+	"http://lv2plug.in/ns/ext/parameters#gain",
+	"http://lv2plug.in/ns/ext/parameters#hold",
+	"http://lv2plug.in/ns/ext/parameters#pulseWidth",
+	"http://lv2plug.in/ns/ext/parameters#ratio",
+	"http://lv2plug.in/ns/ext/parameters#release",
+	"http://lv2plug.in/ns/ext/parameters#resonance",
+	"http://lv2plug.in/ns/ext/parameters#sampleRate",
+	"http://lv2plug.in/ns/ext/parameters#sustain",
+	"http://lv2plug.in/ns/ext/parameters#threshold",
+	"http://lv2plug.in/ns/ext/parameters#waveform",
+	"http://lv2plug.in/ns/ext/parameters#wetDryRatio",
+	"http://lv2plug.in/ns/ext/parameters#wetLevel",
+	"http://lv2plug.in/ns/ext/options#Option",
+	"http://lv2plug.in/ns/ext/options#interface",
+	"http://lv2plug.in/ns/ext/options#options",
+	"http://lv2plug.in/ns/ext/options#requiredOption",
+	"http://lv2plug.in/ns/ext/options#supportedOption",
+	"http://lv2plug.in/ns/ext/state#State",
+	"http://lv2plug.in/ns/ext/state#interface",
+	"http://lv2plug.in/ns/ext/state#loadDefaultState",
+	"http://lv2plug.in/ns/ext/state#makePath",
+	"http://lv2plug.in/ns/ext/state#mapPath",
+	"http://lv2plug.in/ns/ext/state#state",
+	"http://lv2plug.in/ns/ext/state#threadSafeRestore",
+	"http://lv2plug.in/ns/ext/log#Entry",
+	"http://lv2plug.in/ns/ext/log#Error",
+	"http://lv2plug.in/ns/ext/log#Note",
+	"http://lv2plug.in/ns/ext/log#Trace",
+	"http://lv2plug.in/ns/ext/log#Warning",
+	"http://lv2plug.in/ns/ext/log#log",
+	"http://lv2plug.in/ns/ext/worker#interface",
+	"http://lv2plug.in/ns/ext/worker#schedule",
+};
+
+/* hash seed per bucket */
+static const uint16_t static_uri_disp[N_STATIC_BUCKETS] = {
+	2, 2, 2, 1, 4, 1, 2, 1, 1, 2, 1, 0, 2, 1, 3, 2,
+	2, 1, 3, 1, 1, 2, 1, 0, 1, 1, 2, 4, 1, 1, 1, 1,
+	4, 1, 1, 3, 1, 1, 2, 3, 2, 3, 1, 0, 2, 2, 1, 1,
+	2, 1, 1, 3, 1, 0, 0, 3, 1, 1, 1, 1, 5,
+};
+
+/* slot -> URID, 0: empty */
+static const uint16_t static_uri_slot[N_STATIC_SLOTS] = {
+	0, 114, 40, 0, 0, 55, 0, 58, 0, 95, 105, 0, 0, 14, 0, 13,
+	81, 22, 0, 99, 33, 0, 70, 59, 0, 0, 0, 1, 21, 0, 0, 79,
+	0, 0, 0, 0, 0, 0, 75, 0, 0, 0, 68, 0, 0, 83, 60, 66,
+	56, 0, 108, 0, 0, 0, 0, 0, 0, 20, 104, 91, 0, 0, 94, 0,
+	35, 0, 0, 0, 0, 29, 51, 48, 96, 0, 24, 102, 0, 0, 86, 39,
+	0, 2, 0, 9, 0, 0, 92, 118, 97, 65, 0, 111, 0, 74, 6, 0,
+	0, 82, 85, 78, 0, 11, 121, 0, 0, 46, 25, 73, 0, 8, 0, 0,
+	98, 110, 42, 0, 101, 0, 0, 15, 0, 0, 117, 115, 0, 50, 0, 0,
+	67, 7, 28, 76, 0, 0, 72, 10, 0, 0, 0, 84, 0, 45, 109, 57,
+	18, 0, 26, 17, 0, 0, 16, 88, 0, 0, 0, 0, 0, 89, 0, 0,
+	100, 0, 113, 0, 0, 32, 4, 116, 0, 0, 122, 37, 0, 90, 0, 38,
+	0, 53, 44, 0, 63, 34, 0, 93, 0, 119, 54, 0, 23, 61, 52, 0,
+	43, 80, 0, 12, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 107, 0,
+	3, 41, 0, 5, 112, 0, 19, 0, 0, 0, 36, 0, 106, 64, 71, 0,
+	0, 0, 0, 69, 0, 49, 0, 87, 0, 0, 0, 62, 0, 30, 0, 120,
+	0, 0, 0, 0, 0, 0, 0, 27, 103, 0, 77, 47, 0, 0, 31, 0,
+};
+
+#endif
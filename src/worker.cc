@@ -17,20 +17,52 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "worker.h"
 
-#ifdef _WIN32
-#include <windows.h>
-#endif
-
 using namespace Lv2Vlc;
 
-static void* worker_func (void* data)
-{
-	Lv2Worker* self =  (Lv2Worker*)data;
-	self->run ();
-	return NULL;
-}
+/* worker threads are shared by all plugin instances.
+ *
+ * The pool is started when the first Lv2Worker is created and stopped
+ * when the last one is destroyed (pool_ref_lock serializes this).
+ * Each worker keeps its own request queue, idle threads wait on
+ * pool_wake and serve the workers round-robin, one request at a time.
+ * schedule () posts pool_wake for every request: a semaphore post
+ * never blocks, and unlike a signal it is not lost when no thread
+ * is waiting yet.
+ * A worker is only ever handled by one thread at a time (_busy),
+ * so work () is never called concurrently for the same instance.
+ */
+#define N_WORKER_THREADS 2
+
+/* response message types, a response that does not fit into the
+ * ringbuffer is allocated by the worker and passed by reference.
+ * The audio thread hands the memory back via _oob_free, it is
+ * released by the worker thread before it allocates the next one.
+ * So no more references can be outstanding than fit into the
+ * response ring, and _oob_free is sized accordingly.
+ * When freewheeling, responses are made and emitted on the
+ * processing thread, which then frees them directly. */
+#define MSG_INLINE 0
+#define MSG_OOB    1
+
+struct OobMessage {
+	void*    data;
+	uint32_t size;
+};
+
+static vlc_mutex_t  pool_ref_lock = VLC_STATIC_MUTEX;
+static vlc_mutex_t  pool_lock     = VLC_STATIC_MUTEX;
+static vlc_sem_t    pool_wake;
+static vlc_cond_t   pool_idle;
+static vlc_thread_t pool_threads[N_WORKER_THREADS];
+static unsigned int pool_n_threads = 0;
+static Lv2Worker**  pool_workers   = NULL;
+static uint32_t     pool_n_workers = 0;
+static uint32_t     pool_next      = 0;
+static bool         pool_run       = false;
 
 static LV2_Worker_Status lv2_worker_respond (
 		LV2_Worker_Respond_Handle handle,
@@ -41,38 +73,83 @@ static LV2_Worker_Status lv2_worker_respond (
 	return self->respond (size, data);
 }
 
-Lv2Worker::Lv2Worker (const LV2_Worker_Interface* iface, LV2_Handle handle)
-	: _requests (4096)
-	, _responses (4096)
+Lv2Worker::Lv2Worker (const LV2_Worker_Interface* iface, LV2_Handle handle, uint32_t bufsiz)
+	: _requests (Lv2VlcUtil::MessageRing::size_for (bufsiz))
+	, _responses (Lv2VlcUtil::MessageRing::size_for (bufsiz))
+	, _oob_free (_responses.max_messages (sizeof (OobMessage)))
 	, _iface (iface)
 	, _handle (handle)
-	, _run (false)
+	, _busy (false)
 	, _freewheeling (false)
 {
-	vlc_mutex_init (&_lock);
-	vlc_cond_init (&_ready);
-	vlc_clone (&_thread, worker_func, this, 0);
-	while (!_run) {
-#ifdef __APPLE__
-		sched_yield ();
-#elif defined _WIN32
-		Sleep (1);
-#else
-		sched_yield ();
-#endif
+	vlc_mutex_lock (&pool_ref_lock);
+	if (pool_n_workers == 0) {
+		vlc_sem_init (&pool_wake, 0);
+		vlc_cond_init (&pool_idle);
+		pool_run = true;
+		for (unsigned int i = 0; i < N_WORKER_THREADS; ++i) {
+			if (vlc_clone (&pool_threads[pool_n_threads], pool_thread, NULL, VLC_THREAD_PRIORITY_LOW)) {
+				fprintf (stderr, "LV2Host: failed to start worker thread %u\n", i);
+				break;
+			}
+			++pool_n_threads;
+		}
 	}
+
+	vlc_mutex_lock (&pool_lock);
+	Lv2Worker** w = (Lv2Worker**) realloc (pool_workers, (pool_n_workers + 1) * sizeof (Lv2Worker*));
+	if (w) {
+		pool_workers = w;
+		pool_workers[pool_n_workers++] = this;
+	}
+	vlc_mutex_unlock (&pool_lock);
+	vlc_mutex_unlock (&pool_ref_lock);
 }
 
 Lv2Worker::~Lv2Worker ()
 {
-	vlc_mutex_lock (&_lock);
-	_run = false;
-	vlc_cond_signal (&_ready);
-	vlc_mutex_unlock (&_lock);
-
-	vlc_join (_thread, NULL);
-	vlc_mutex_destroy (&_lock);
-	vlc_cond_destroy (&_ready);
+	vlc_mutex_lock (&pool_ref_lock);
+	vlc_mutex_lock (&pool_lock);
+	for (uint32_t i = 0; i < pool_n_workers; ++i) {
+		if (pool_workers[i] == this) {
+			pool_workers[i] = pool_workers[--pool_n_workers];
+			break;
+		}
+	}
+	while (_busy) {
+		vlc_cond_wait (&pool_idle, &pool_lock);
+	}
+
+	const bool last = pool_n_workers == 0;
+	if (last) {
+		pool_run = false;
+	}
+	vlc_mutex_unlock (&pool_lock);
+
+	if (last) {
+		for (unsigned int i = 0; i < pool_n_threads; ++i) {
+			vlc_sem_post (&pool_wake);
+		}
+		for (unsigned int i = 0; i < pool_n_threads; ++i) {
+			vlc_join (pool_threads[i], NULL);
+		}
+		pool_n_threads = 0;
+		free (pool_workers);
+		pool_workers = NULL;
+		vlc_sem_destroy (&pool_wake);
+		vlc_cond_destroy (&pool_idle);
+	}
+	vlc_mutex_unlock (&pool_ref_lock);
+
+	uint32_t size, type;
+	const void* data;
+	while ((data = _responses.peek (&size, &type))) {
+		if (type == MSG_OOB) {
+			free (((const OobMessage*)data)->data);
+		}
+		_responses.consume ();
+	}
+	free_oob ();
 }
 
 LV2_Worker_Status Lv2Worker::schedule (uint32_t size, const void* data)
@@ -81,62 +158,115 @@ LV2_Worker_Status Lv2Worker::schedule (uint32_t size, const void* data)
 		_iface->work (_handle, lv2_worker_respond, this, size, data);
 		return LV2_WORKER_SUCCESS;
 	}
-	_requests.write ((const char*)&size, sizeof (size));
-	_requests.write ((const char*)data, size);
-	if (vlc_mutex_trylock (&_lock) == 0) {
-		vlc_cond_signal (&_ready);
-		vlc_mutex_unlock (&_lock);
+	void* dst = _requests.reserve (size);
+	if (!dst) {
+		return LV2_WORKER_ERR_NO_SPACE;
 	}
+	memcpy (dst, data, size);
+	_requests.commit ();
+	vlc_sem_post (&pool_wake);
 	return LV2_WORKER_SUCCESS;
 }
 
 LV2_Worker_Status Lv2Worker::respond (uint32_t size, const void* data)
 {
-	if (_responses.write_space () >= sizeof (size) + size) {
-		_responses.write ((const char*)&size, sizeof (size));
-		_responses.write ((const char*)data, size);
+	if (_responses.write (data, size)) {
+		return LV2_WORKER_SUCCESS;
 	}
+
+	if (!_freewheeling) {
+		free_oob ();
+	}
+	OobMessage* oob = (OobMessage*) _responses.reserve (sizeof (OobMessage), MSG_OOB);
+	if (!oob || !(oob->data = malloc (size))) {
+		return LV2_WORKER_ERR_NO_SPACE;
+	}
+	memcpy (oob->data, data, size);
+	oob->size = size;
+	_responses.commit ();
 	return LV2_WORKER_SUCCESS;
 }
 
 void Lv2Worker::emit_response ()
 {
-	uint32_t read_space = _responses.read_space ();
-	while (read_space) {
-		uint32_t size = 0;
-		char worker_response[4096];
-		_responses.read ((char*)&size, sizeof (size));
-		_responses.read (worker_response, size);
-		_iface->work_response (_handle, size, worker_response);
-		read_space -= sizeof (size) + size;
+	uint32_t size, type;
+	const void* data;
+	while ((data = _responses.peek (&size, &type))) {
+		if (type == MSG_OOB) {
+			const OobMessage* oob = (const OobMessage*) data;
+			_iface->work_response (_handle, oob->size, oob->data);
+			if (_freewheeling) {
+				free (oob->data);
+			} else if (!_oob_free.write (&oob->data, 1)) {
+				free (oob->data); // last resort, not reached in normal operation
+			}
+		} else {
+			_iface->work_response (_handle, size, data);
+		}
+		_responses.consume ();
+	}
+}
+
+/* called with pool_lock held, the request queue of a worker
+ * that is not _busy is not accessed by any other thread. */
+Lv2Worker* Lv2Worker::next_pending ()
+{
+	for (uint32_t i = 0; i < pool_n_workers; ++i) {
+		const uint32_t n = (pool_next + i) % pool_n_workers;
+		Lv2Worker* w = pool_workers[n];
+		uint32_t size;
+		if (!w->_busy && w->_requests.peek (&size)) {
+			pool_next = n + 1;
+			return w;
+		}
+	}
+	return NULL;
+}
+
+void Lv2Worker::free_oob ()
+{
+	void* mem;
+	while (_oob_free.read (&mem, 1) == 1) {
+		free (mem);
 	}
 }
 
 void Lv2Worker::run ()
 {
-	vlc_mutex_lock (&_lock);
-	_run = true;
-	while (1) {
-		char buf[4096];
-		uint32_t size = 0;
+	free_oob ();
 
-		if (_requests.read_space () <= sizeof (size)) {
-			vlc_cond_wait (&_ready, &_lock);
-		}
+	uint32_t size;
+	const void* data = _requests.peek (&size);
+	if (data) {
+		_iface->work (_handle, lv2_worker_respond, this, size, data);
+		_requests.consume ();
+	}
+}
 
-		if (!_run) {
+void* Lv2Worker::pool_thread (void*)
+{
+	while (1) {
+		vlc_sem_wait (&pool_wake);
+
+		vlc_mutex_lock (&pool_lock);
+		if (!pool_run) {
+			vlc_mutex_unlock (&pool_lock);
 			break;
 		}
+		/* a request of a worker that is _busy with another thread
+		 * is picked up by that thread when it is done */
+		Lv2Worker* w;
+		while ((w = next_pending ())) {
+			w->_busy = true;
+			vlc_mutex_unlock (&pool_lock);
 
-		_requests.read ((char*)&size, sizeof (size));
+			w->run ();
 
-		if (size > 4096) {
-			fprintf (stderr, "LV2Host: Worker information is too large. Abort.\n");
-			break;
+			vlc_mutex_lock (&pool_lock);
+			w->_busy = false;
+			vlc_cond_broadcast (&pool_idle);
 		}
-
-		_requests.read (buf, size);
-		_iface->work (_handle, lv2_worker_respond, this, size, buf);
+		vlc_mutex_unlock (&pool_lock);
 	}
-	vlc_mutex_unlock (&_lock);
+	return NULL;
 }
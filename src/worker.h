@@ -32,7 +32,11 @@ namespace Lv2Vlc {
 class Lv2Worker
 {
 	public:
-		Lv2Worker (const LV2_Worker_Interface* iface, LV2_Handle handle);
+		/* bufsiz: largest message that is guaranteed to fit into an empty queue.
+		 * Larger responses are passed out-of-band. Larger requests are
+		 * rejected with LV2_WORKER_ERR_NO_SPACE: they are scheduled from
+		 * the audio thread, which must not allocate. */
+		Lv2Worker (const LV2_Worker_Interface* iface, LV2_Handle handle, uint32_t bufsiz);
 		~Lv2Worker ();
 
 		static LV2_Worker_Status lv2_worker_schedule (
@@ -48,7 +52,6 @@ class Lv2Worker
 		LV2_Worker_Status respond (uint32_t size, const void* data);
 		void emit_response ();
 		void set_freewheeling (bool yn) { _freewheeling = yn; }
-		void run ();
 		void end_run () {
 			if (_iface->end_run) {
 				_iface->end_run (_handle);
@@ -56,16 +59,20 @@ class Lv2Worker
 		}
 
 	private:
-		Lv2VlcUtil::RingBuffer<char> _requests;
-		Lv2VlcUtil::RingBuffer<char> _responses;
+		void run ();
+		void free_oob ();
+
+		static void*      pool_thread (void*);
+		static Lv2Worker* next_pending ();
+
+		Lv2VlcUtil::MessageRing      _requests;
+		Lv2VlcUtil::MessageRing      _responses;
+		Lv2VlcUtil::RingBuffer<void*> _oob_free;
 
 		const LV2_Worker_Interface*  _iface;
 		LV2_Handle                   _handle;
 
-		vlc_thread_t                 _thread;
-		vlc_mutex_t                  _lock;
-		vlc_cond_t                   _ready;
-		volatile bool                _run;
+		bool                         _busy; // processed by a pool thread, protected by pool_lock
 		bool                         _freewheeling;
 };
 
@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+# generate src/uri_table.h: well-known LV2 URIs with fixed URIDs
+# and a perfect hash (hash and displace) to look them up.
+# Re-run after update_lv2stack.sh
+
+import re
+import sys
+
+LV2 = 'local/include/lv2/lv2plug.in/ns/'
+OUT = 'src/uri_table.h'
+
+# header, prefix of the macros to include
+SOURCES = [
+	('ext/atom/atom.h',             'LV2_ATOM__'),
+	('ext/buf-size/buf-size.h',     'LV2_BUF_SIZE__'),
+	('ext/midi/midi.h',             'LV2_MIDI__MidiEvent'),
+	('ext/time/time.h',             'LV2_TIME__'),
+	('ext/patch/patch.h',           'LV2_PATCH__'),
+	('ext/parameters/parameters.h', 'LV2_PARAMETERS__'),
+	('ext/options/options.h',       'LV2_OPTIONS__'),
+	('ext/state/state.h',           'LV2_STATE__'),
+	('ext/log/log.h',               'LV2_LOG__'),
+	('ext/worker/worker.h',         'LV2_WORKER__'),
+]
+
+def mask32(x):
+	return x & 0xffffffff
+
+# must match Lv2UriMap::hash_static () in src/uri_map.cc
+def uri_hash(uri, seed):
+	h = mask32(2166136261 ^ mask32(seed * 0x9e3779b9))
+	for c in uri.encode('utf-8'):
+		h = mask32((h ^ c) * 16777619)
+	h ^= h >> 15
+	h = mask32(h * 0x2c1b3c6d)
+	h ^= h >> 12
+	return h
+
+def read_uris():
+	macros = {}
+	order = []
+	for header, prefix in SOURCES:
+		with open(LV2 + header) as f:
+			for line in f:
+				m = re.match(r'\s*#\s*define\s+(\w+)\s+(.*)', line)
+				if not m:
+					continue
+				name, value = m.group(1), re.sub(r'/\*.*?\*/|//[^"]*$', '', m.group(2)).strip()
+				macros[name] = value
+				if name.startswith(prefix) and '__' in name:
+					order.append(name)
+
+	def resolve(value):
+		out = ''
+		for tok in re.findall(r'"[^"]*"|\w+', value):
+			if tok.startswith('"'):
+				out += tok[1:-1]
+			else:
+				out += resolve(macros[tok])
+		return out
+
+	uris = []
+	for name in order:
+		uri = resolve(macros[name])
+		if uri not in uris:
+			uris.append(uri)
+	return uris
+
+def build(uris):
+	n = len(uris)
+	n_buckets = max(1, n // 2)
+	n_slots = 1
+	while n_slots < n * 5 // 4:
+		n_slots *= 2
+
+	buckets = [[] for _ in range(n_buckets)]
+	for i, uri in enumerate(uris):
+		buckets[uri_hash(uri, 0) % n_buckets].append(i)
+
+	disp = [0] * n_buckets
+	slots = [0] * n_slots
+	for b in sorted(range(n_buckets), key=lambda b: -len(buckets[b])):
+		if not buckets[b]:
+			continue
+		for d in range(1, 65536):
+			pos = [uri_hash(uris[i], d) & (n_slots - 1) for i in buckets[b]]
+			if len(set(pos)) == len(pos) and all(slots[p] == 0 for p in pos):
+				for i, p in zip(buckets[b], pos):
+					slots[p] = i + 1
+				disp[b] = d
+				break
+		else:
+			sys.exit('no displacement found')
+	return disp, slots
+
+def emit(uris, disp, slots):
+	def table(values, per_line):
+		lines = []
+		for i in range(0, len(values), per_line):
+			lines.append('\t' + ', '.join('%d' % v for v in values[i:i + per_line]) + ',')
+		return '\n'.join(lines)
+
+	with open(OUT, 'w') as f:
+		f.write('/* generated by update_uri_table.py -- do not edit */\n\n')
+		f.write('#ifndef _uri_table_h_\n#define _uri_table_h_\n\n')
+		f.write('#define N_STATIC_URIS %d\n' % len(uris))
+		f.write('#define N_STATIC_BUCKETS %d\n' % len(disp))
+		f.write('#define N_STATIC_SLOTS %d\n\n' % len(slots))
+		f.write('/* URID = index + 1 */\n')
+		f.write('static const char* const static_uris[N_STATIC_URIS] = {\n')
+		for uri in uris:
+			f.write('\t"%s",\n' % uri)
+		f.write('};\n\n')
+		f.write('/* hash seed per bucket */\n')
+		f.write('static const uint16_t static_uri_disp[N_STATIC_BUCKETS] = {\n%s\n};\n\n' % table(disp, 16))
+		f.write('/* slot -> URID, 0: empty */\n')
+		f.write('static const uint16_t static_uri_slot[N_STATIC_SLOTS] = {\n%s\n};\n\n' % table(slots, 16))
+		f.write('#endif\n')
+
+uris = read_uris()
+disp, slots = build(uris)
+emit(uris, disp, slots)
+print('%d URIs, %d buckets, %d slots' % (len(uris), len(disp), len(slots)))